@@ -9,7 +9,6 @@ using namespace rubik_cube;
 
 std::random_device rd;
 std::mt19937 mt(rd());
-const char* data_file = "krof.dat";
 const char* face_str = "UDFBLR";
 
 bool is_file_exist(const char* filename)
@@ -28,7 +27,7 @@ void output_usage(std::string str = "")
 {
 	if(!str.empty())
 		std::printf("Error: %s\n", str.c_str());
-	std::puts("Usage: ./solver -tra");
+	std::puts("Usage: ./solver -tral");
 	std::puts("-t maximum thread used to calculate [default: 1].");
 	std::puts("-r random rotation times to generate a cube.");
 	std::puts("   when using Krof, default is 15.");
@@ -36,6 +35,8 @@ void output_usage(std::string str = "")
 	std::puts("-a which algorithm to be used to solve the cube.");
 	std::puts("   only two algorithms available: krof, kociemba.");
 	std::puts("   [default: kociemba]");
+	std::puts("-l milliseconds used to search shorter solutions by Kociemba.");
+	std::puts("   [default: 0, the first solution found]");
 	std::exit(0);
 }
 
@@ -47,7 +48,7 @@ int main(int argc, char** argv)
 		if(argv[i][0] == '-')
 		{
 			std::string key = argv[i] + 1;
-			if(key != "t" && key != "r" && key != "a")
+			if(key != "t" && key != "r" && key != "a" && key != "l")
 				output_usage();
 
 			M[key] = argv[++i];
@@ -82,27 +83,31 @@ int main(int argc, char** argv)
 			output_usage("thread number is too large!");
 	}
 
+	int time_limit = 0;
+	if(M.count("l"))
+	{
+		time_limit = std::atoi(M["l"].c_str());
+		if(time_limit < 0)
+			output_usage("time limit cannot be negative!");
+	}
+
 	auto viewer = create_opengl_viewer();
 
 	std::shared_ptr<algo_t> algo;
+	std::string data_file = algo_type + ".dat";
 	if(algo_type == "krof")
-	{
 		algo = create_krof_algo(thread_num);
+	else algo = create_kociemba_algo(thread_num, 0, time_limit);
 
-		if(is_file_exist(data_file))
-		{
-			std::puts("Reading data file...");
-			algo->init(data_file);
-		} else {
-			std::puts("Initializing heuristic function table...");
-			algo->init();
-			algo->save("krof.dat");  
-		}
+	if(is_file_exist(data_file.c_str()))
+	{
+		std::puts("Reading data file...");
+		algo->init(data_file.c_str());
 	} else {
-		algo = create_kociemba_algo(thread_num);
-
 		std::puts("Initializing heuristic function table...");
 		algo->init();
+		if(!algo->save(data_file.c_str()))
+			std::puts("Failed to save data file.");
 	}
 
 	cube_t c;
@@ -134,6 +139,9 @@ int main(int argc, char** argv)
 		viewer->add_rotate(x.first, x.second);
 	}
 
+	if(!cube_t::compose(c, cube_t(ans)).is_solved())
+		std::puts("\nError: the solution does not solve the cube!");
+
 	std::printf("\nSolution needs %d steps.", (int)ans.size());
 	std::fflush(stdout);
 	viewer->run();
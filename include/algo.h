@@ -3,11 +3,44 @@
 #include "cube.h"
 #include <vector>
 #include <memory>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <functional>
 
 namespace rubik_cube
 {
-	typedef std::pair<face_t::face_type, int> move_step_t;
-	typedef std::vector<move_step_t> move_seq_t;
+	/* the solving is stopped when the deadline is reached or *cancel
+	 * is set by another thread, the threads searching for it return
+	 * soon after that */
+	struct solve_limit_t
+	{
+		typedef std::chrono::steady_clock clock_t;
+
+		clock_t::time_point deadline = clock_t::time_point::max();
+		const std::atomic<bool> *cancel = nullptr;
+	};
+
+	struct solve_result_t
+	{
+		enum status_t { solved, timeout, cancelled, searching };
+
+		status_t status;
+		/* empty if the cube is not solved, unless a longer solution is
+		 * found before stopped (e.g. the anytime Kociemba) */
+		move_seq_t solution;
+		/* the length of the optimal solution is at least lower_bound */
+		int lower_bound;
+		/* the nodes searched so far. the depths before the last one
+		 * are searched exhaustively, so the nodes of two orders of
+		 * the children differ by the nodes to the first solution */
+		uint64_t nodes;
+	};
+
+	/* called by the thread solving the cube with the status searching,
+	 * when the lower bound is raised (i.e. a depth is finished) or a
+	 * better solution is found */
+	typedef std::function<void(const solve_result_t&)> solve_progress_t;
 
 	class algo_t
 	{
@@ -15,12 +48,62 @@ namespace rubik_cube
 		virtual ~algo_t() = default;
 	public:
 		virtual void init(const char* filename = nullptr) = 0;
-		virtual void save(const char* filename) const = 0;
-		virtual move_seq_t solve(cube_t) const = 0;
+		/* returns false if the file is not written */
+		virtual bool save(const char* filename) const = 0;
+		virtual solve_result_t solve(cube_t, const solve_limit_t&,
+			const solve_progress_t& progress = nullptr) const = 0;
+
+		move_seq_t solve(cube_t c) const { return solve(c, solve_limit_t()).solution; }
+
+		/* solve the cube by a thread of the shared pool, this object
+		 * and *limit.cancel should be alive until it is done. done and
+		 * progress are called by that thread */
+		std::future<solve_result_t> solve_async(cube_t,
+			const solve_limit_t& = solve_limit_t(),
+			const solve_progress_t& progress = nullptr) const;
+		void solve_async(cube_t, std::function<void(solve_result_t)> done,
+			const solve_limit_t& = solve_limit_t(),
+			const solve_progress_t& progress = nullptr) const;
+
+		/* solve the cubes by this thread and thread_num - 1 workers of a
+		 * pool shared by the algorithms, at most thread_num (at least 1)
+		 * cubes are solved at a time. when few cubes are left, the
+		 * solving of a cube is split to the idle workers of the pool if
+		 * the algorithm is created with more than one thread, up to
+		 * that number */
+		std::vector<solve_result_t> solve_batch(const std::vector<cube_t>&,
+			int thread_num, const solve_limit_t& = solve_limit_t()) const;
+
+		/* the visits of the transposition table by all the solving, which
+		 * prune the cube (hits) or not (misses), 0 if there is no table */
+		virtual uint64_t transposition_hits() const { return 0; }
+		virtual uint64_t transposition_misses() const { return 0; }
 	};
 
-	std::shared_ptr<algo_t> create_krof_algo(int thread_num = 1);
-	std::shared_ptr<algo_t> create_kociemba_algo(int thread_num = 1);
+	/* mod3_tables stores the distance mod 3 in 2 bits instead of 4 bits,
+	 * which halves the memory and costs more time when solving.
+	 * edges_group is the number of edges in the edges table (6, 7 or 8),
+	 * the larger tables take about 65 MB (7) and 160 MB (8) in 4 bits
+	 * and need much fewer nodes to solve a cube.
+	 * if perimeter_depth (at most 7) is positive, all the cubes within
+	 * perimeter_depth moves are stored in a hash table built by init,
+	 * which finishes the last moves of the searching at once. it takes
+	 * about 16 MB (5), 128 MB (6) and 2 GB (7) and is not saved.
+	 * if transposition_mb is positive, a transposition table of that
+	 * size prunes the cubes explored again by the same iteration, see
+	 * algo_t::transposition_hits.
+	 * if sort_children is set, the children are searched by increasing
+	 * estimate instead of the order of the moves, see move_stats_t */
+	std::shared_ptr<algo_t> create_krof_algo(int thread_num = 1, bool mod3_tables = false,
+		int edges_group = 6, int perimeter_depth = 0, int transposition_mb = 0,
+		bool sort_children = false);
+
+	/* if target_length or time_limit (in milliseconds) is positive, the
+	 * search continues for shorter solutions after the first one, until
+	 * a solution of at most target_length moves is found or the time
+	 * limit is reached, and the best solution is returned */
+	std::shared_ptr<algo_t> create_kociemba_algo(int thread_num = 1,
+		int target_length = 0, int time_limit = 0, bool sort_children = false);
 }
 
 #endif // __ALGO_H__
@@ -5,6 +5,7 @@
 #define __CUBE_H__
 
 #include <utility>
+#include <vector>
 #include <cstdint>
 
 namespace rubik_cube
@@ -32,6 +33,9 @@ struct block_t
 
 typedef std::pair<const int8_t*, const int8_t*> block_info_t;
 
+typedef std::pair<face_t::face_type, int> move_step_t;
+typedef std::vector<move_step_t> move_seq_t;
+
 /*
  * observing from the top face, the index of corners will be like this
  *     *-*-*-*        *-*-*-*
@@ -60,6 +64,12 @@ class cube_t
 {
 public:
 	cube_t();
+	/* construct a cube from the position and orientation of 
+	 * the corners and edges, see getCornerBlock and getEdgeBlock */
+	cube_t(const int8_t *cp, const int8_t *co, const int8_t *ep, const int8_t *eo);
+	/* the cube after applying the move sequence to the solved cube,
+	 * which can be applied to other cubes later by compose() */
+	explicit cube_t(const move_seq_t&);
 public:
 	/* look from the top face
 	 * *-----------------*
@@ -79,6 +89,18 @@ public:
 
 	/* rotate a face 90 * count degree clockwise */
 	void rotate(face_t::face_type, int count = 1);
+
+	/* the cube obtained by applying the moves of b to a, i.e.
+	 * the block at position i is the block at position b.cp[i] of a,
+	 * so that compose(a, cube_t(seq)) is a after rotating seq */
+	static cube_t compose(const cube_t& a, const cube_t& b);
+
+	/* compose(c, c.inverse()) and compose(c.inverse(), c) are solved */
+	cube_t inverse() const;
+
+	bool is_solved() const;
+	bool operator == (const cube_t&) const;
+	bool operator != (const cube_t& r) const { return !(*this == r); }
 private:
 	int8_t cp[8], co[8];   // corners' position and orientation
 	int8_t ep[12], eo[12]; // edges' position and orientation
@@ -0,0 +1,104 @@
+#include "algo.h"
+#include "thread_pool.hpp"
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <algorithm>
+#include <condition_variable>
+
+namespace rubik_cube
+{
+
+std::vector<solve_result_t> algo_t::solve_batch(
+	const std::vector<cube_t>& cubes,
+	int thread_num,
+	const solve_limit_t& limit) const
+{
+	std::vector<solve_result_t> results(cubes.size());
+	if(cubes.empty())
+		return results;
+
+	// this thread takes the cubes with thread_num - 1 workers, so the
+	// cubes are solved even if it is a worker and the others are busy
+	thread_num = std::max(1, thread_num);
+	thread_pool_t& pool = thread_pool_t::shared();
+	pool.reserve(thread_num - 1);
+
+	// the tasks not started when the cubes are all taken are never
+	// waited, so they only keep the state, which outlives this call
+	struct batch_t
+	{
+		std::mutex m;
+		std::condition_variable cv;
+		std::atomic<size_t> next{0};
+		int running = 0;
+		bool closed = false;
+	};
+
+	auto batch = std::make_shared<batch_t>();
+	auto take = [this, &cubes, &results, &limit](batch_t& b) {
+		for(size_t i; (i = b.next++) < cubes.size(); )
+			results[i] = solve(cubes[i], limit);
+	};
+
+	// the pool may have more workers, so thread_num tasks take the
+	// cubes in turn. they are pushed to the shared queue, which the
+	// idle workers take before stealing the split subtrees of the others
+	const int task_num = std::min<int>(thread_num, cubes.size());
+	for(int k = 1; k < task_num; ++k)
+	{
+		pool.submit_shared([batch, take] {
+			{
+				std::lock_guard<std::mutex> lk(batch->m);
+				if(batch->closed) return;
+				++batch->running;
+			}
+
+			take(*batch);
+
+			std::lock_guard<std::mutex> lk(batch->m);
+			if(--batch->running == 0)
+				batch->cv.notify_all();
+		} );
+	}
+
+	take(*batch);
+
+	std::unique_lock<std::mutex> lk(batch->m);
+	batch->closed = true;
+	batch->cv.wait(lk, [&] { return batch->running == 0; });
+	return results;
+}
+
+std::future<solve_result_t> algo_t::solve_async(
+	cube_t cb,
+	const solve_limit_t& limit,
+	const solve_progress_t& progress) const
+{
+	auto promise = std::make_shared<std::promise<solve_result_t>>();
+	solve_async(cb, [promise](solve_result_t r) {
+		promise->set_value(std::move(r));
+	}, limit, progress);
+
+	return promise->get_future();
+}
+
+void algo_t::solve_async(
+	cube_t cb,
+	std::function<void(solve_result_t)> done,
+	const solve_limit_t& limit,
+	const solve_progress_t& progress) const
+{
+	// the solving tasks run on all the cores, the solving of a cube is
+	// split to more threads only if the algorithm is created with them
+	thread_pool_t& pool = thread_pool_t::shared();
+	pool.reserve(std::max(1u, std::thread::hardware_concurrency()));
+
+	// pushed to the shared queue, so that a callback solving another
+	// cube never leaves it to the queue of its worker
+	pool.submit_shared([this, cb, done, limit, progress] {
+		done(solve(cb, limit, progress));
+	} );
+}
+
+} // namespace rubik_cube
@@ -2,7 +2,14 @@
 #include "cube.h"
 #include "search.hpp"
 #include "heuristic.hpp"
+#include "symmetry.hpp"
+#include "table_file.hpp"
+#include "move_automaton.hpp"
+#include <vector>
+#include <cstdint>
 #include <cstring>
+#include <chrono>
+#include <algorithm>
 #include <functional>
 
 namespace rubik_cube
@@ -11,15 +18,23 @@ namespace rubik_cube
 namespace __kociemba_algo_impl
 {
 
+/* coordinates of a cube used in searching
+ *   phrase 1: x = slice edges, y = corners orientation, z = edges orientation 
+ *   phrase 2: x = corners, y = U/D edges, z = slice edges */
+struct coord_t
+{
+	int x, y, z;
+};
+
 class kociemba_t : public algo_t
 {
 public:
-	kociemba_t(int thread_num);
+	kociemba_t(int thread_num, int target_length, int time_limit, bool sort_children);
 	~kociemba_t() = default;
 public:
 	void init(const char*);
-	void save(const char*) const;
-	move_seq_t solve(cube_t) const;
+	bool save(const char*) const;
+	solve_result_t solve(cube_t, const solve_limit_t&, const solve_progress_t&) const;
 private:
 	static int encode_phrase1_edges(const cube_t&);
 	static int encode_phrase1_co(const cube_t&);
@@ -27,107 +42,399 @@ private:
 	static int encode_phrase2_corners(const cube_t&);
 	static int encode_phrase2_edges1(const cube_t&);
 	static int encode_phrase2_edges2(const cube_t&);
+
+	static cube_t decode_phrase1_edges(int);
+	static cube_t decode_phrase1_co(int);
+	static cube_t decode_phrase1_eo(int);
+	static cube_t decode_phrase2_corners(int);
+	static cube_t decode_phrase2_edges1(int);
+	static cube_t decode_phrase2_edges2(int);
 private:
-	template<int Size, typename PushFunc>
-	static void init_permutation(int, int8_t*, const PushFunc&, int);
+	typedef pruning_table_t<4> table_t;
+
+	template<int Phrase, typename T>
+	static void init_move(T (*)[18], int, cube_t(*)(int), int(*)(const cube_t&));
+	template<int Phrase, typename MoveFunc>
+	static void init_pruning(table_t&, int, const std::vector<int>&, const MoveFunc&);
+	void init_move_tables();
+	void init_symmetry();
+	void init_pruning_tables();
+
+	template<typename T>
+	bool load_move(const char*, T (*)[18], int);
+	bool load_pruning(const char*, table_t&, int);
+	bool load_tables();
 private:
+	/* the state of searching the shorter solutions, see solve_anytime */
+	struct anytime_info_t
+	{
+		cube_t cb;
+		move_seq_t best;
+		int best_length, lower_bound;
+		uint64_t node;
+		std::chrono::steady_clock::time_point deadline;
+		search_limit_t *limit;
+		const solve_progress_t *progress;
+		bool stop;
+	};
+
+	solve_result_t solve_anytime(const cube_t&, search_limit_t&, const solve_progress_t&) const;
+	void search_anytime(anytime_info_t&, const coord_t&, int g, int state, move_seq_t&) const;
+	void solve_anytime_phrase2(anytime_info_t&, const move_seq_t&) const;
+	void check_anytime(anytime_info_t&) const;
+
+	template<int Phrase>
+	bool search_phrase(const basic_search_info_t<coord_t>&) const;
+	template<int Phrase>
+	int expand_phrase(const basic_search_info_t<coord_t>&, search_child_t<coord_t>*) const;
 	template<int Phrase>
-	bool search_phrase(const search_info_t&) const;
+	int estimate(const coord_t&, int bound = 0xff) const;
 	template<int Phrase>
-	int estimate(const cube_t&) const;
+	coord_t rotate(const coord_t&, int) const;
 
-	int estimate_phrase1(const cube_t&) const;
-	int estimate_phrase2(const cube_t&) const;
+	int reduce_phrase1_edges(int) const;
+	coord_t encode_phrase1(const cube_t&) const;
+	coord_t encode_phrase2(const cube_t&) const;
+	int estimate_phrase1(const coord_t&, int bound) const;
+	int estimate_phrase2(const coord_t&, int bound) const;
 private:
 	static const int phrase2_corners_size = 40320; // 8!
 	static const int phrase2_edges1_size = 40320;  // 8!
 	static const int phrase2_edges2_size = 24;     // 4!
-	static const int phrase1_edges_size = 12 * 11 * 10 * 9 * 16;
-	static const int phrase1_co_size = 6561;
-	static const int phrase1_eo_size = 1 << 8;
-	int8_t phrase2_corners[phrase2_corners_size];
-	int8_t phrase2_edges1[phrase2_edges1_size];
-	int8_t phrase2_edges2[phrase2_edges2_size];
-	int8_t phrase1_edges[phrase1_edges_size];
-	int8_t phrase1_co[phrase1_co_size];
-	int8_t phrase1_eo[phrase1_eo_size];
+	static const int phrase1_edges_size = 12 * 11 * 10 * 9 * 16; // before reduced
+	static const int phrase1_co_size = 2187;       // 3^7
+	static const int phrase1_eo_size = 1 << 11;
+	table_t phrase2_corners;
+	table_t phrase2_edges1;
+	table_t phrase2_edges2;
+	table_t phrase1_co;
+	table_t phrase1_eo;
+
+	/* move tables, indexed by [coordinate][face * 3 + count - 1],
+	 * the positions of the slice edges are moved as a whole and
+	 * the lowest 4 bits is the change of their orientation */
+	static const int phrase1_slice_size = phrase1_edges_size >> 4;
+	uint32_t phrase1_edges_move[phrase1_slice_size][18];
+	uint16_t phrase1_co_move[phrase1_co_size][18];
+	uint16_t phrase1_eo_move[phrase1_eo_size][18];
+	uint16_t phrase2_corners_move[phrase2_corners_size][18];
+	uint16_t phrase2_edges1_move[phrase2_edges1_size][18];
+	uint8_t phrase2_edges2_move[phrase2_edges2_size][18];
+
+	/* the slice edges are reduced by the 16 symmetries keeping the UD
+	 * axis, indexed by (permutation class, orientation 2^4).
+	 *   phrase1_edges_sym: class << 8 | s << 4 | the change of orientation
+	 *   phrase1_edges_conj: the permutation of the orientation bits
+	 *   phrase1_edges_stab: s << 4 | the change of orientation, for the
+	 *     symmetries keeping the representative */
+	sym_perm_t<12, 4> slice_sym;
+	uint32_t phrase1_edges_sym[phrase1_slice_size];
+	uint8_t phrase1_edges_conj[symmetry_t::ud_count][16];
+	std::vector<std::vector<uint8_t>> phrase1_edges_stab;
+	table_t phrase1_edges;
+
+	/* changed when the codes of the tables are changed */
+	static const uint32_t table_version = 1;
+	table_file_t file;
 	int thread_num;
+	const move_automaton_t& automaton;
+
+	/* the anytime search is used if either of them is positive */
+	int target_length, time_limit;
+
+	/* the moves of the solutions of each phrase break the ties
+	 * when sort_children is set */
+	bool sort_children;
+	mutable move_stats_t phrase_stats[2];
 }; // class kociemba_t
 
-kociemba_t::kociemba_t(int thread_num)
+kociemba_t::kociemba_t(int thread_num, int target_length, int time_limit, bool sort_children)
+	: automaton(move_automaton_t::shared())
 {
 	this->thread_num = thread_num;
+	this->target_length = target_length;
+	this->time_limit = time_limit;
+	this->sort_children = sort_children;
+}
+
+template<int Phrase, typename T>
+void kociemba_t::init_move(
+	T (*move)[18], int size, 
+	cube_t(*decoder)(int), 
+	int(*encoder)(const cube_t&))
+{
+	for(int v = 0; v != size; ++v)
+	{
+		cube_t c = decoder(v);
+		for(int i = 0; i != 6; ++i)
+		{
+			cube_t cube = c;
+			for(int j = 1; j <= 3; ++j)
+			{
+				cube.rotate(face_t::face_type(i), 1);
+				if(Phrase == 1 || i < 2 || j == 2)
+					move[v][i * 3 + j - 1] = encoder(cube);
+			}
+		}
+	}
 }
 
-template<int Size, typename PushFunc>
-void kociemba_t::init_permutation(int now, int8_t* v, const PushFunc& push, int avail)
+template<int Phrase, typename MoveFunc>
+void kociemba_t::init_pruning(
+	table_t& table, int size, 
+	const std::vector<int>& init_state, 
+	const MoveFunc& move)
 {
-	if(!avail) return push();
+	table.assign(size);
+	for(int v : init_state)
+		table.visit(v, 0);
 
-	for(int i = 0; i != Size; ++i)
+	for(int step = 0, updated = 1; updated; ++step)
 	{
-		if((avail >> i) & 1)
+		updated = 0;
+		for(int v = 0; v != size; ++v)
 		{
-			avail ^= 1 << i;
-			v[now] = i;
-			init_permutation<Size>(now + 1, v, push, avail);
-			avail ^= 1 << i;
+			if(table.get(v) != step)
+				continue;
+
+			for(int m = 0; m != 18; ++m)
+			{
+				if(Phrase == 2 && m >= 6 && m % 3 != 1)
+					continue;
+
+				if(table.visit(move(v, m), step + 1))
+					updated = 1;
+			}
 		}
 	}
 }
 
-void kociemba_t::init(const char*)
+void kociemba_t::init_move_tables()
 {
-	std::vector<cube_t> states;
+	// the slice edges are decoded to be oriented, so the lowest
+	// 4 bits of the code is exactly the change of the orientation
+	init_move<1>(phrase1_edges_move, phrase1_slice_size, [](int v) {
+		return decode_phrase1_edges(v << 4);
+	}, &kociemba_t::encode_phrase1_edges);
+
+	init_move<1>(phrase1_co_move, phrase1_co_size, 
+		&kociemba_t::decode_phrase1_co, &kociemba_t::encode_phrase1_co);
+	init_move<1>(phrase1_eo_move, phrase1_eo_size, 
+		&kociemba_t::decode_phrase1_eo, &kociemba_t::encode_phrase1_eo);
+
+	init_move<2>(phrase2_corners_move, phrase2_corners_size, 
+		&kociemba_t::decode_phrase2_corners, &kociemba_t::encode_phrase2_corners);
+	init_move<2>(phrase2_edges1_move, phrase2_edges1_size, 
+		&kociemba_t::decode_phrase2_edges1, &kociemba_t::encode_phrase2_edges1);
+	init_move<2>(phrase2_edges2_move, phrase2_edges2_size, 
+		&kociemba_t::decode_phrase2_edges2, &kociemba_t::encode_phrase2_edges2);
+}
 
-	std::memset(phrase2_corners, 0xff, sizeof(phrase2_corners));
-	init_heuristic<true>(phrase2_corners, &kociemba_t::encode_phrase2_corners);
+void kociemba_t::init_symmetry()
+{
+	static const int8_t slice_group[] = { 0, 1, 2, 3 };
 
-	std::memset(phrase2_edges1, 0xff, sizeof(phrase2_edges1));
-	init_heuristic<true>(phrase2_edges1, &kociemba_t::encode_phrase2_edges1);
+	std::vector<int> syms;
+	for(int s = 0; s != symmetry_t::ud_count; ++s)
+		syms.push_back(s);
+	slice_sym.init(slice_group, syms);
 
-	std::memset(phrase2_edges2, 0xff, sizeof(phrase2_edges2));
-	init_heuristic<true, true>(phrase2_edges2, &kociemba_t::encode_phrase2_edges2, &states);
+	for(int s = 0; s != symmetry_t::ud_count; ++s)
+		for(int v = 0; v != 16; ++v)
+		{
+			int t = 0;
+			for(int q = 0; q != 4; ++q)
+				t |= ((v >> q) & 1) << symmetry_t::edge_piece[s][q];
+			phrase1_edges_conj[s][v] = t;
+		}
+
+	// the change of the orientation only depends on the positions
+	auto orient_mask = [](const int8_t *pos, int s) {
+		int mask = 0;
+		for(int q = 0; q != 4; ++q)
+			mask |= symmetry_t::edge_orient[s][int(pos[q])][q][0] << q;
+		return mask;
+	};
 
-	for(cube_t& c : states)
+	for(int v = 0; v != phrase1_slice_size; ++v)
 	{
-		// fix the orientation
-		int8_t *eo = const_cast<int8_t*>(c.getEdgeBlock().second);
-		eo[0] = eo[1] = eo[2] = eo[3] = 0;
+		int8_t pos[12];
+		decode_perm<12, 4>(v, pos, factorial_12);
+
+		uint32_t t = slice_sym.lookup(v);
+		int s = t & 0x3f;
+		phrase1_edges_sym[v] = (t >> 8) << 8 | s << 4 | orient_mask(pos, s);
+	}
+
+	phrase1_edges_stab.resize(slice_sym.class_num());
+	for(int c = 0; c != slice_sym.class_num(); ++c)
+	{
+		int8_t pos[12];
+		decode_perm<12, 4>(slice_sym.representative(c), pos, factorial_12);
+
+		phrase1_edges_stab[c].clear();
+		for(int8_t s : slice_sym.stabilizer(c))
+			phrase1_edges_stab[c].push_back(s << 4 | orient_mask(pos, s));
 	}
+}
+
+int kociemba_t::reduce_phrase1_edges(int x) const
+{
+	uint32_t t = phrase1_edges_sym[x >> 4];
+	int c = t >> 8;
+	int v = phrase1_edges_conj[(t >> 4) & 0xf][(x ^ t) & 0xf];
+
+	int r = v;
+	for(uint8_t u : phrase1_edges_stab[c])
+		r = std::min<int>(r, phrase1_edges_conj[u >> 4][v ^ (u & 0xf)]);
+
+	return c << 4 | r;
+}
+
+void kociemba_t::init_pruning_tables()
+{
+	const cube_t cube0;
+
+	init_pruning<2>(phrase2_corners, phrase2_corners_size, 
+		{ encode_phrase2_corners(cube0) }, 
+		[this](int v, int m) { return phrase2_corners_move[v][m]; } );
+	init_pruning<2>(phrase2_edges1, phrase2_edges1_size, 
+		{ encode_phrase2_edges1(cube0) },
+		[this](int v, int m) { return phrase2_edges1_move[v][m]; } );
+	init_pruning<2>(phrase2_edges2, phrase2_edges2_size, 
+		{ encode_phrase2_edges2(cube0) },
+		[this](int v, int m) { return phrase2_edges2_move[v][m]; } );
+
+	// the slice edges are in the middle level and oriented
+	std::vector<int> slice_states;
+	for(int v = 0; v != phrase1_slice_size; ++v)
+	{
+		int8_t perm[12];
+		decode_perm<12, 4>(v, perm, factorial_12);
+		if(perm[0] < 4 && perm[1] < 4 && perm[2] < 4 && perm[3] < 4)
+			slice_states.push_back(reduce_phrase1_edges(v << 4));
+	}
+
+	init_pruning<1>(phrase1_edges, slice_sym.class_num() << 4, slice_states,
+		[this](int v, int m) { 
+			int x = slice_sym.representative(v >> 4) << 4 | (v & 0xf);
+			uint32_t t = phrase1_edges_move[x >> 4][m];
+			return reduce_phrase1_edges(int(t ^ (x & 0xf)));
+		} );
+	init_pruning<1>(phrase1_co, phrase1_co_size, 
+		{ encode_phrase1_co(cube0) },
+		[this](int v, int m) { return phrase1_co_move[v][m]; } );
+	init_pruning<1>(phrase1_eo, phrase1_eo_size, 
+		{ encode_phrase1_eo(cube0) },
+		[this](int v, int m) { return phrase1_eo_move[v][m]; } );
+}
+
+template<typename T>
+bool kociemba_t::load_move(const char* name, T (*move)[18], int size)
+{
+	const uint8_t *data = file.find(name, sizeof(T) * 8, size * 18);
+	if(data) std::memcpy(move, data, sizeof(T) * 18 * size);
+	return data != nullptr;
+}
+
+bool kociemba_t::load_pruning(const char* name, table_t& table, int size)
+{
+	const uint8_t *data = file.find(name, table_t::bits, size);
+	if(data) table.attach(data, size);
+	return data != nullptr;
+}
 
-	std::memset(phrase1_edges, 0xff, sizeof(phrase1_edges));
-	init_heuristic<false>(phrase1_edges, &kociemba_t::encode_phrase1_edges, nullptr, states);
+/* the move tables are copied since they are small, and the
+ * pruning tables use the mapped file */
+bool kociemba_t::load_tables()
+{
+	return load_move("p1_slice_move", phrase1_edges_move, phrase1_slice_size)
+		&& load_move("p1_co_move", phrase1_co_move, phrase1_co_size)
+		&& load_move("p1_eo_move", phrase1_eo_move, phrase1_eo_size)
+		&& load_move("p2_corner_move", phrase2_corners_move, phrase2_corners_size)
+		&& load_move("p2_edge1_move", phrase2_edges1_move, phrase2_edges1_size)
+		&& load_move("p2_edge2_move", phrase2_edges2_move, phrase2_edges2_size)
+		&& load_pruning("p1_slice", phrase1_edges, slice_sym.class_num() << 4)
+		&& load_pruning("p1_co", phrase1_co, phrase1_co_size)
+		&& load_pruning("p1_eo", phrase1_eo, phrase1_eo_size)
+		&& load_pruning("p2_corner", phrase2_corners, phrase2_corners_size)
+		&& load_pruning("p2_edge1", phrase2_edges1, phrase2_edges1_size)
+		&& load_pruning("p2_edge2", phrase2_edges2, phrase2_edges2_size);
+}
 
-	states.clear();
+void kociemba_t::init(const char* filename)
+{
+	init_symmetry();
 
-	cube_t cube0;
-	int8_t *cube0_ep = const_cast<int8_t*>(cube0.getCornerBlock().first);
-	init_permutation<8>(0, cube0_ep, [&]() {
-		states.push_back(cube0);
-	}, (1 << 8) - 1 );
+	if(filename && file.open(filename, "kociemba", table_version) && load_tables())
+		return;
 
-	std::memset(phrase1_co, 0xff, sizeof(phrase1_co));
-	init_heuristic<false>(phrase1_co, &kociemba_t::encode_phrase1_co, nullptr, states);
+	// the file is missing or does not match, build the tables
+	file.close();
+	init_move_tables();
+	init_pruning_tables();
+}
 
-	states.clear();
-	cube0 = cube_t();
+namespace
+{
+	template<typename T>
+	table_file_t::table_info_t move_info(const char* name, const T (*move)[18], int size)
+	{
+		return { name, int(sizeof(T) * 8), size * 18, 
+			reinterpret_cast<const uint8_t*>(move), sizeof(T) * 18 * size };
+	}
 
-	init_permutation<12>(4, cube0_ep, [&]() {
-		states.push_back(cube0);
-	}, ((1 << 8) - 1) << 4 );
+	template<typename Table>
+	table_file_t::table_info_t pruning_info(const char* name, const Table& table)
+	{
+		return { name, Table::bits, table.size(), table.data(), Table::bytes(table.size()) };
+	}
+
+	/* appends the phrase 2 solution, whose first move is merged with
+	 * the last one of phrase 1 if they turn the same face */
+	void append_phrase2(move_seq_t& solution, const move_seq_t& seq)
+	{
+		auto it = seq.begin();
+		if(it != seq.end() && !solution.empty() && it->first == solution.back().first)
+		{
+			int count = (solution.back().second + it->second) % 4;
+			solution.pop_back();
+			if(count != 0)
+				solution.push_back(move_step_t{it->first, count});
+			++it;
+		}
 
-	std::memset(phrase1_eo, 0xff, sizeof(phrase1_eo));
-	init_heuristic<false>(phrase1_eo, &kociemba_t::encode_phrase1_eo, nullptr, states);
+		solution.insert(solution.end(), it, seq.end());
+	}
 }
 
-void kociemba_t::save(const char*) const
+bool kociemba_t::save(const char* filename) const
 {
-	// do nothing
+	return table_file_t::save(filename, "kociemba", table_version, {
+		move_info("p1_slice_move", phrase1_edges_move, phrase1_slice_size),
+		move_info("p1_co_move", phrase1_co_move, phrase1_co_size),
+		move_info("p1_eo_move", phrase1_eo_move, phrase1_eo_size),
+		move_info("p2_corner_move", phrase2_corners_move, phrase2_corners_size),
+		move_info("p2_edge1_move", phrase2_edges1_move, phrase2_edges1_size),
+		move_info("p2_edge2_move", phrase2_edges2_move, phrase2_edges2_size),
+		pruning_info("p1_slice", phrase1_edges),
+		pruning_info("p1_co", phrase1_co),
+		pruning_info("p1_eo", phrase1_eo),
+		pruning_info("p2_corner", phrase2_corners),
+		pruning_info("p2_edge1", phrase2_edges1),
+		pruning_info("p2_edge2", phrase2_edges2)
+	} );
 }
 
-move_seq_t kociemba_t::solve(cube_t cb) const
+/* the lower bound is the distance to G1, which is raised when a depth
+ * of phrase 1 is finished */
+solve_result_t kociemba_t::solve(cube_t cb, const solve_limit_t& l, const solve_progress_t& progress) const
 {
+	search_limit_t limit(l);
+	if(target_length > 0 || time_limit > 0)
+		return solve_anytime(cb, limit, progress);
+
+	int lower_bound = estimate<1>(encode_phrase1(cb));
 	move_seq_t solution;
 
 	// phrase 1
@@ -135,28 +442,40 @@ move_seq_t kociemba_t::solve(cube_t cb) const
 	{
 		move_seq_t seq(depth);
 
-		search_info_t s;
-		s.cb    = cb;
+		basic_search_info_t<coord_t> s;
+		s.cb    = encode_phrase1(cb);
 		s.g     = 0;
 		s.seq   = &seq;
-		s.face  = 6;
+		s.state = move_automaton_t::start;
 		s.depth = depth;
+		s.job   = nullptr;
+		s.limit = &limit;
 
+		bool found;
 		if(depth < 7 || thread_num == 1) 
 		{
-			s.tid = -1;
-			if(search_phrase<1>(s))
-			{
-				solution = *s.seq;
-				break;
-			}
+			found = search_phrase<1>(s) && !limit.stopped();
 		} else {
 			using namespace std::placeholders;
-			if(search_multi_thread(thread_num, s, std::bind(&kociemba_t::search_phrase<1>, this, _1)))
-			{
-				solution = *s.seq;
-				break;
-			}
+			found = search_multi_thread(thread_num, s, 
+				std::bind(&kociemba_t::search_phrase<1>, this, _1));
+		}
+
+		if(found)
+		{
+			solution = *s.seq;
+			phrase_stats[0].learn(solution);
+			break;
+		}
+
+		if(limit.stopped())
+			return { limit.status(), {}, lower_bound, limit.node_count() };
+
+		if(depth + 1 > lower_bound)
+		{
+			lower_bound = depth + 1;
+			if(progress)
+				progress({ solve_result_t::searching, {}, lower_bound, limit.node_count() });
 		}
 	}
 
@@ -168,38 +487,204 @@ move_seq_t kociemba_t::solve(cube_t cb) const
 	{
 		move_seq_t seq(depth);
 
-		search_info_t s;
-		s.cb    = cb;
+		basic_search_info_t<coord_t> s;
+		s.cb    = encode_phrase2(cb);
 		s.g     = 0;
 		s.seq   = &seq;
-		s.face  = 6;
+		s.state = move_automaton_t::start;
 		s.depth = depth;
-		s.tid   = -1;
+		s.job   = nullptr;
+		s.limit = &limit;
 
-		if(search_phrase<2>(s))
+		bool found;
+		if(depth < 10 || thread_num == 1)
 		{
-			if(seq.front().first == solution.back().first)
-			{
-				// merge rotation of same faces;
-				seq[0].second = (seq[0].second + solution.back().second) % 4;
-				solution.pop_back();
-			}  
+			found = search_phrase<2>(s) && !limit.stopped();
+		} else {
+			using namespace std::placeholders;
+			found = search_multi_thread(thread_num, s, 
+				std::bind(&kociemba_t::search_phrase<2>, this, _1));
+		}
 
-			for(move_step_t step : seq)
-				solution.push_back(step);
+		if(found)
+		{
+			phrase_stats[1].learn(seq);
+			append_phrase2(solution, seq);
 			break;
 		}
+
+		if(limit.stopped())
+			return { limit.status(), {}, lower_bound, limit.node_count() };
 	}
 
 	for(move_step_t& step : solution)
 		if(step.second == 3)
 			step.second = -1;
 
-	return solution;
+	return { solve_result_t::solved, solution, lower_bound, limit.node_count() };
+}
+
+/* the phrase 1 solutions are enumerated by increasing length, each
+ * of them is completed by the shortest phrase 2 solution which makes
+ * the total length shorter than the best one. it stops when the best
+ * length is at most target_length, the time limit is reached after
+ * a solution is found, or the phrase 1 length reaches the best one.
+ * if the limit is expired, the best solution found is returned */
+solve_result_t kociemba_t::solve_anytime(const cube_t& cb, search_limit_t& limit, const solve_progress_t& progress) const
+{
+	coord_t c = encode_phrase1(cb);
+
+	anytime_info_t a;
+	a.cb          = cb;
+	a.best_length = 100;
+	a.lower_bound = estimate<1>(c);
+	a.node        = 0;
+	a.deadline    = std::chrono::steady_clock::now() + std::chrono::milliseconds(time_limit);
+	a.limit       = &limit;
+	a.progress    = &progress;
+	a.stop        = false;
+
+	for(int depth = a.lower_bound; depth < a.best_length && !a.stop; ++depth)
+	{
+		move_seq_t seq(depth);
+		search_anytime(a, c, 0, move_automaton_t::start, seq);
+
+		// no phrase 1 solution of this depth
+		if(a.best.empty() && !a.stop)
+		{
+			a.lower_bound = depth + 1;
+			if(progress)
+				progress({ solve_result_t::searching, {}, a.lower_bound, a.node + limit.node_count() });
+		}
+	}
+
+	for(move_step_t& step : a.best)
+		if(step.second == 3)
+			step.second = -1;
+
+	return { limit.status(), a.best, a.lower_bound, a.node + limit.node_count() };
+}
+
+void kociemba_t::search_anytime(anytime_info_t& a, const coord_t& c, int g, int state, move_seq_t& seq) const
+{
+	if((++a.node & 0x3ff) == 0)
+		check_anytime(a);
+
+	if(a.limit->expired())
+		a.stop = true;
+
+	if(a.stop) return;
+
+	const int depth = seq.size();
+	if(g == depth)
+	{
+		solve_anytime_phrase2(a, seq);
+		return;
+	}
+
+	for(int i = 0; i != 6; ++i)
+	{
+		for(int j = 1; j <= 3; ++j)
+		{
+			int next = automaton.next(state, i * 3 + j - 1);
+			if(next < 0)
+				continue;
+
+			// a phrase 1 solution ending with a move of G1 was found
+			// as a shorter one, since the cube before it is in G1
+			if(g + 1 == depth && (i < 2 || j == 2))
+				continue;
+
+			coord_t t = rotate<1>(c, i * 3 + j - 1);
+			if(estimate<1>(t, depth - g - 1) + g + 1 <= depth)
+			{
+				seq[g] = move_step_t{face_t::face_type(i), j};
+				search_anytime(a, t, g + 1, next, seq);
+				if(a.stop) return;
+			}
+		}
+	}
 }
 
+void kociemba_t::solve_anytime_phrase2(anytime_info_t& a, const move_seq_t& solution) const
+{
+	cube_t cb = a.cb;
+	for(const move_step_t& step : solution)
+		cb.rotate(step.first, step.second);
+
+	// phrase 2 starts from the start state of the automaton, since
+	// a canonical sequence across the two phrases may reorder the last
+	// moves of phrase 1 into a sequence not ending in G1
+	// a solution of depth moves may be one move shorter after the merge
+	coord_t c = encode_phrase2(cb);
+	for(int depth = estimate<2>(c); solution.size() + depth <= size_t(a.best_length); ++depth)
+	{
+		move_seq_t seq(depth);
+
+		basic_search_info_t<coord_t> s;
+		s.cb    = c;
+		s.g     = 0;
+		s.seq   = &seq;
+		s.state = move_automaton_t::start;
+		s.depth = depth;
+		s.job   = nullptr;
+		s.limit = a.limit;
+
+		if(depth == 0 ? estimate<2>(c) == 0 : search_phrase<2>(s))
+		{
+			if(a.limit->stopped())
+			{
+				a.stop = true;
+				return;
+			}
+
+			// the longer ones are not shorter after the merge either
+			move_seq_t best = solution;
+			append_phrase2(best, seq);
+			if(best.size() >= size_t(a.best_length))
+				return;
+
+			phrase_stats[1].learn(seq);
+			a.best = best;
+			a.best_length = a.best.size();
+
+			if(*a.progress)
+			{
+				solve_result_t r = { solve_result_t::searching, a.best,
+					a.lower_bound, a.node + a.limit->node_count() };
+				for(move_step_t& step : r.solution)
+					if(step.second == 3)
+						step.second = -1;
+				(*a.progress)(r);
+			}
+
+			check_anytime(a);
+			return;
+		}
+	}
+}
+
+void kociemba_t::check_anytime(anytime_info_t& a) const
+{
+	if(a.best.empty() && a.best_length != 0)
+		return;
+
+	if(a.best_length <= target_length || (time_limit > 0
+		&& std::chrono::steady_clock::now() >= a.deadline))
+		a.stop = true;
+}
+
+template<int Phrase>
+bool kociemba_t::search_phrase(const basic_search_info_t<coord_t>& s) const
+{
+	return search_ida(s, [this](const basic_search_info_t<coord_t>& u, search_child_t<coord_t>* out) {
+		return expand_phrase<Phrase>(u, out);
+	} );
+}
+
+/* the children not pruned are stored to out */
 template<int Phrase>
-bool kociemba_t::search_phrase(const search_info_t& s) const
+int kociemba_t::expand_phrase(const basic_search_info_t<coord_t>& s, search_child_t<coord_t>* out) const
 {
 #ifdef DEBUG
 	static uint64_t cnt = 0;
@@ -210,80 +695,101 @@ bool kociemba_t::search_phrase(const search_info_t& s) const
 	}
 #endif
 
-	if(s.tid >= 0 && *s.result_id >= 0)
-		return true;
-
-	search_info_t t = s;
-	t.g += 1;
-
+	int num = 0, h[18];
+	const uint32_t allowed = automaton.allowed(s.state);
 	for(int i = 0; i != 6; ++i)
 	{
-		if(i == s.face || disallow_faces[i] == s.face)
-			continue;
-
-		cube_t cube = s.cb;
 		for(int j = 1; j <= 3; ++j)
 		{
-			if(Phrase == 1)
-			{
-				cube.rotate(face_t::face_type(i), 1);
-			} else {
-				if(i >= 2 && j != 2) continue;
-				cube.rotate(face_t::face_type(i), i < 2 ? 1 : j);
-			}
+			if(Phrase == 2 && i >= 2 && j != 2) 
+				continue;
 
-			int h = estimate<Phrase>(cube);
-			if(h + s.g + 1 <= s.depth)
-			{
-				(*s.seq)[s.g] = move_step_t{face_t::face_type(i), j};
+			const int m = i * 3 + j - 1;
+			if((allowed >> m & 1) == 0)
+				continue;
 
-				if(h == 0)
+			coord_t c = rotate<Phrase>(s.cb, m);
+			h[num] = estimate<Phrase>(c, s.depth - s.g - 1);
+			if(h[num] + s.g + 1 <= s.depth)
+			{
+				if(h[num] == 0)
 				{
-					if(s.tid >= 0)
-						*s.result_id = s.tid;
-					return true;
+					(*s.seq)[s.g] = move_step_t{face_t::face_type(i), j};
+					return -1;
 				}
 
-				t.cb   = cube;
-				t.face = i;
-
-				if(search_phrase<Phrase>(t))
-					return true;
+				out[num++] = { c, m, automaton.next(s.state, m) };
 			}
 		}
 	}
 
-	return false;
+	if(sort_children)
+		phrase_stats[Phrase - 1].sort(out, h, num);
+	return num;
 }
 
 template<int Phrase>
-int kociemba_t::estimate(const cube_t& c) const
+coord_t kociemba_t::rotate(const coord_t& c, int m) const
+{
+	if(Phrase == 1)
+	{
+		return { 
+			int(phrase1_edges_move[c.x >> 4][m] ^ (c.x & 0xf)),
+			phrase1_co_move[c.y][m],
+			phrase1_eo_move[c.z][m]
+		};
+	}
+
+	return {
+		phrase2_corners_move[c.x][m],
+		phrase2_edges1_move[c.y][m],
+		phrase2_edges2_move[c.z][m]
+	};
+}
+
+/* the tables are read from the smallest one, and it returns once the
+ * estimate is more than bound, which prunes the cube anyway */
+template<int Phrase>
+int kociemba_t::estimate(const coord_t& c, int bound) const
 {
 	if(Phrase == 1) 
-		return estimate_phrase1(c);
-	return estimate_phrase2(c);
+		return estimate_phrase1(c, bound);
+	return estimate_phrase2(c, bound);
+}
+
+int kociemba_t::estimate_phrase1(const coord_t& c, int bound) const
+{
+	// the edges are reduced by the symmetries before the lookup
+	int h = std::max(phrase1_co.get(c.y), phrase1_eo.get(c.z));
+	if(h > bound) return h;
+	return std::max(h, phrase1_edges.get(reduce_phrase1_edges(c.x)));
 }
 
-int kociemba_t::estimate_phrase1(const cube_t& c) const
+int kociemba_t::estimate_phrase2(const coord_t& c, int bound) const
 {
-	return std::max(
-		phrase1_edges[encode_phrase1_edges(c)],
-		std::max(
-			phrase1_eo[encode_phrase1_eo(c)],
-			phrase1_co[encode_phrase1_co(c)]
-		)
-	);
+	int h = phrase2_edges2.get(c.z);
+	if(h > bound) return h;
+	h = std::max(h, phrase2_corners.get(c.x));
+	if(h > bound) return h;
+	return std::max(h, phrase2_edges1.get(c.y));
 }
 
-int kociemba_t::estimate_phrase2(const cube_t& c) const
+coord_t kociemba_t::encode_phrase1(const cube_t& c) const
 {
-	return std::max(
-		phrase2_corners[encode_phrase2_corners(c)],
-		std::max(
-			phrase2_edges1[encode_phrase2_edges1(c)],
-			phrase2_edges2[encode_phrase2_edges2(c)]
-		)
-	);
+	return { 
+		encode_phrase1_edges(c), 
+		encode_phrase1_co(c), 
+		encode_phrase1_eo(c) 
+	};
+}
+
+coord_t kociemba_t::encode_phrase2(const cube_t& c) const
+{
+	return { 
+		encode_phrase2_corners(c), 
+		encode_phrase2_edges1(c), 
+		encode_phrase2_edges2(c) 
+	};
 }
 
 int kociemba_t::encode_phrase2_corners(const cube_t& c) 
@@ -325,11 +831,10 @@ int kociemba_t::encode_phrase1_edges(const cube_t& c)
 
 int kociemba_t::encode_phrase1_co(const cube_t& c)
 {
-	static const int base[] = { 1, 3, 9, 27, 81, 243, 729, 2187 };
 	block_info_t cb = c.getCornerBlock();
 	int v = 0;
-	for(int i = 0; i != 8; ++i)
-		v += cb.second[i] * base[i];
+	for(int i = 6; i >= 0; --i)
+		v = v * 3 + cb.second[i];
 	return v;
 }
 
@@ -337,16 +842,96 @@ int kociemba_t::encode_phrase1_eo(const cube_t& c)
 {
 	block_info_t eb = c.getEdgeBlock();
 	int v = 0;
-	for(int i = 0; i != 8; ++i)
-		v |= eb.second[i + 4] << i;
+	for(int i = 0; i != 11; ++i)
+		v |= eb.second[i] << i;
 	return v;
 }
 
+cube_t kociemba_t::decode_phrase2_corners(int v)
+{
+	int8_t cp[8], co[8] = { 0 };
+	decode_perm<8, 7>(v, cp, factorial_8);
+
+	cube_t c;
+	block_info_t eb = c.getEdgeBlock();
+	return cube_t(cp, co, eb.first, eb.second);
+}
+
+cube_t kociemba_t::decode_phrase2_edges1(int v)
+{
+	int8_t perm[8], ep[12], eo[12] = { 0 };
+	decode_perm<8, 7>(v, perm, factorial_8);
+	for(int i = 0; i != 4; ++i)
+		ep[i] = i;
+	for(int i = 4; i != 12; ++i)
+		ep[i] = perm[i - 4] + 4;
+
+	cube_t c;
+	block_info_t cb = c.getCornerBlock();
+	return cube_t(cb.first, cb.second, ep, eo);
+}
+
+cube_t kociemba_t::decode_phrase2_edges2(int v)
+{
+	int8_t ep[12], eo[12] = { 0 };
+	decode_perm<4, 3>(v, ep, factorial_4);
+	for(int i = 4; i != 12; ++i)
+		ep[i] = i;
+
+	cube_t c;
+	block_info_t cb = c.getCornerBlock();
+	return cube_t(cb.first, cb.second, ep, eo);
+}
+
+cube_t kociemba_t::decode_phrase1_edges(int v)
+{
+	int8_t pos[12], ep[12], eo[12] = { 0 };
+	decode_perm<12, 4>(v >> 4, pos, factorial_12);
+	for(int i = 0; i != 12; ++i)
+		ep[pos[i]] = i;
+	for(int i = 0; i != 4; ++i)
+		eo[pos[i]] = (v >> i) & 1;
+
+	cube_t c;
+	block_info_t cb = c.getCornerBlock();
+	return cube_t(cb.first, cb.second, ep, eo);
+}
+
+cube_t kociemba_t::decode_phrase1_co(int v)
+{
+	int8_t co[8];
+	int sum = 0;
+	for(int i = 0; i != 7; ++i, v /= 3)
+		sum += co[i] = v % 3;
+	co[7] = (3 - sum % 3) % 3;
+
+	cube_t c;
+	block_info_t cb = c.getCornerBlock();
+	block_info_t eb = c.getEdgeBlock();
+	return cube_t(cb.first, co, eb.first, eb.second);
+}
+
+cube_t kociemba_t::decode_phrase1_eo(int v)
+{
+	int8_t eo[12];
+	int sum = 0;
+	for(int i = 0; i != 11; ++i)
+		sum += eo[i] = (v >> i) & 1;
+	eo[11] = sum & 1;
+
+	cube_t c;
+	block_info_t cb = c.getCornerBlock();
+	block_info_t eb = c.getEdgeBlock();
+	return cube_t(cb.first, cb.second, eb.first, eo);
+}
+
 } // namespace __kociemba_algo_impl
 
-std::shared_ptr<algo_t> create_kociemba_algo(int thread_num)
+std::shared_ptr<algo_t> create_kociemba_algo(int thread_num,
+	int target_length, int time_limit, bool sort_children)
 {
-	return std::make_shared<__kociemba_algo_impl::kociemba_t>(thread_num);
+	return std::make_shared<__kociemba_algo_impl::kociemba_t>(
+		thread_num, target_length, time_limit, sort_children);
 }
 
 } // namespace rubik_cube
@@ -2,7 +2,13 @@
 #include "cube.h"
 #include "search.hpp"
 #include "heuristic.hpp"
-#include <fstream>
+#include "packed_cube.hpp"
+#include "symmetry.hpp"
+#include "table_file.hpp"
+#include "perimeter.hpp"
+#include "transposition.hpp"
+#include "move_automaton.hpp"
+#include <vector>
 #include <cstdint>
 #include <cstring>
 #include <cstdlib>
@@ -15,239 +21,816 @@ namespace rubik_cube
 namespace __krof_algo_impl
 {
 
+/* the group of K edges stored in the edges table, and the symmetries
+ * moving the other groups looked up in the same table to this group */
+template<int K>
+struct edges_group_t;
+
+template<>
+struct edges_group_t<6>
+{
+	static const int image_num = 2;
+	static const int8_t blocks[6];
+	static const int images[2][3][3];
+};
+
+template<>
+struct edges_group_t<7>
+{
+	static const int image_num = 2;
+	static const int8_t blocks[7];
+	static const int images[2][3][3];
+};
+
+template<>
+struct edges_group_t<8>
+{
+	static const int image_num = 3;
+	static const int8_t blocks[8];
+	static const int images[3][3][3];
+};
+
+// the edges in the top level and two edges in the back of the
+// middle level, the other ones are moved here by rotating x2.
+// only the identity and one other symmetry keep this group
+const int8_t edges_group_t<6>::blocks[6] = { 4, 5, 6, 7, 0, 1 };
+const int edges_group_t<6>::images[2][3][3] =
+{
+	{ { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 } },
+	{ { 1, 0, 0 }, { 0, -1, 0 }, { 0, 0, -1 } }  // x2
+};
+
+// the edges of the 6-edge group and the back edge in the bottom level
+const int8_t edges_group_t<7>::blocks[7] = { 4, 5, 6, 7, 0, 1, 8 };
+const int edges_group_t<7>::images[2][3][3] =
+{
+	{ { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 } },
+	{ { 1, 0, 0 }, { 0, -1, 0 }, { 0, 0, -1 } }  // x2
+};
+
+// the edges in the top and bottom level, the other groups are the
+// edges in the front and back, left and right faces
+const int8_t edges_group_t<8>::blocks[8] = { 4, 5, 6, 7, 8, 9, 10, 11 };
+const int edges_group_t<8>::images[3][3][3] =
+{
+	{ { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 } },
+	{ { 1, 0, 0 }, { 0, 0, -1 }, { 0, 1, 0 } }, // x
+	{ { 0, 0, 1 }, { 0, 1, 0 }, { -1, 0, 0 } }  // z
+};
+
+/* the codes of the corners and the edges used to index the tables */
+template<int K>
+class krof_coder_t
+{
+public:
+	typedef edges_group_t<K> group_t;
+	static const int image_num = group_t::image_num;
+	static const int edges_perm_size = sym_perm_t<12, K>::perm_size;
+public:
+	/* the symmetry lookup of the edges is built unless it is given */
+	void init(const uint32_t *edges_sym_table = nullptr);
+	const uint32_t* edges_sym_table() const { return edges_sym.data(); }
+
+	/* copy the symmetry lookup of the edges to each NUMA node, the one
+	 * of the corners has only 8! entries */
+	void replicate() { edges_sym.replicate(); }
+
+	int corners_size() const { return corners_sym.class_num() * corners_orient_size; }
+	int edges_size() const { return edges_sym.class_num() * edges_orient_size; }
+
+	int encode_corners(block_info_t) const;
+	int encode_edges(block_info_t, int j) const;
+	packed_cube_t decode_corners(int) const;
+	packed_cube_t decode_edges(int) const;
+private:
+	static int encode_corners_orient(const int8_t*, const int8_t*, int);
+	int encode_edges_orient(const int8_t*, const int8_t*, int) const;
+private:
+	/* the corners are reduced by all the 48 symmetries, the table
+	 * is indexed by (permutation class, orientation 3^7).
+	 *
+	 * the edges are looked up as image_num groups of K edges, each
+	 * group is moved to the first one by a symmetry so that they share
+	 * the table, which is indexed by (permutation class, orientation
+	 * 2^K) and reduced by the symmetries keeping the first group.
+	 * only 2 symmetries keep the group of 6 edges (4 for 7 edges and
+	 * 16 for 8 edges), and no group of 6 edges whose complement is
+	 * its image is kept by more than 4. with the sharing, the table of
+	 * 6 edges (332928 classes * 2^6) is only 4 times smaller than the
+	 * two tables without symmetries. */
+	static const int corners_orient_size = 2187; // 3^7
+	static const int edges_orient_size = 1 << K;
+	sym_perm_t<8, 8> corners_sym;
+	sym_perm_t<12, K> edges_sym;
+
+	/* edges_scan[j][p][q] is (k, position, orientation xor) of the block
+	 * q at position p after conjugating by the j-th image, k is its
+	 * index in the group or K.
+	 *
+	 * edges_ori_conj[s] moves the bits of the orientation of the solved
+	 * group to the blocks they become after conjugating by s. */
+	int8_t edges_scan[image_num][12][12][3];
+	uint8_t edges_ori_conj[symmetry_t::count][edges_orient_size];
+}; // class krof_coder_t
+
+/* Table is pruning_table_t, the tables are built exactly and then
+ * stored in Table. K is the number of edges in the edges table. */
+template<typename Table, int K>
 class krof_t : public algo_t
 {
 public:
-	krof_t(int thread_num);
+	krof_t(int thread_num, int perimeter_depth, int transposition_mb, bool sort_children);
 	~krof_t() = default;
 public:
 	void init(const char*);
-	void save(const char*) const;
-	move_seq_t solve(cube_t) const;
-private:
-	static int encode_corners(const cube_t&);
-	static int encode_edges1(const cube_t&);
-	static int encode_edges2(const cube_t&);
+	bool save(const char*) const;
+	solve_result_t solve(cube_t, const solve_limit_t&, const solve_progress_t&) const;
+	uint64_t transposition_hits() const { return transposition.hits(); }
+	uint64_t transposition_misses() const { return transposition.misses(); }
 private:
-	int estimate(const cube_t&) const;
-	int estimate_edges(const cube_t&) const;
+	typedef krof_coder_t<K> coder_t;
+	static const int lookup_num = coder_t::image_num + 1;
+
+	/* the inverse cube has the same distance, so its codes are also
+	 * looked up in the tables. this is only done for the exact tables,
+	 * since the inverse of a child is not a neighbour of the inverse
+	 * of its parent in the tables, whose distance cannot be recovered
+	 * from the distance mod 3 */
+	static const bool dual = Table::exact;
+
+	/* h is the distance of the corners and the groups of edges,
+	 * which recovers the distance of the children if Table only
+	 * stores it mod 3. stamp is the iteration in the transposition
+	 * table */
+	struct node_t
+	{
+		packed_cube_t cube, inverse;
+		int8_t h[lookup_num];
+		uint32_t stamp;
+	};
+
+	/* the transposition table is only used by the cubes with at
+	 * least transposition_depth moves left, whose subtrees are
+	 * much larger than a lookup */
+	static const int transposition_depth = 5;
+
+	typedef basic_search_info_t<node_t> search_info_t;
+	typedef search_child_t<node_t> child_t;
+	int encode(const packed_cube_t&, int k) const;
+	int lookup(int code, int k) const;
+	int distance(const packed_cube_t&, int k) const;
+	node_t make_node(const packed_cube_t&) const;
+	void encode(const packed_cube_t&, int *code) const;
+	void encode_edges(const packed_cube_t&, int *code) const;
+	void prefetch(const int *code) const;
+	int lookup(const int *code) const;
+	int estimate(const node_t& parent, node_t&, const int *code, int begin, int end, int bound) const;
+	int expand(const search_info_t&, child_t*) const;
 	bool search(const search_info_t&) const;
+
+	/* copy the tables looked up by the search to each NUMA node */
+	void replicate();
 private:
-	static const int corners_size = 88179840; // 3^7 * 8!
-	static const int edges_size = 42577920;   // 2^6 * 12! / 6!
-	int8_t corners[corners_size];
-	int8_t edges1[edges_size];
-	int8_t edges2[edges_size];
+	/* changed when the codes of the tables are changed */
+	static const uint32_t table_version = 1;
+
+	coder_t coder;
+	table_file_t file;
+	Table corners;
+	Table edges;
 	int thread_num;
+	const move_automaton_t& automaton;
+
+	/* the children with at most perimeter.depth() moves left are
+	 * solved or pruned by the perimeter, not searched */
+	int perimeter_depth;
+	perimeter_t perimeter;
+
+	int transposition_mb;
+	transposition_table_t transposition;
+
+	bool sort_children;
+	mutable move_stats_t move_stats;
 }; // class krof_t
 
 
-krof_t::krof_t(int thread_num)
+template<typename Table, int K>
+krof_t<Table, K>::krof_t(int thread_num, int perimeter_depth, int transposition_mb, bool sort_children)
+	: automaton(move_automaton_t::shared())
 {
 	this->thread_num = thread_num;
+	this->perimeter_depth = perimeter_depth;
+	this->transposition_mb = transposition_mb;
+	this->sort_children = sort_children;
 }
 
-move_seq_t krof_t::solve(cube_t cb) const
+/* every depth less than the searching one has no solution, which is
+ * the lower bound if the limit is expired */
+template<typename Table, int K>
+solve_result_t krof_t<Table, K>::solve(cube_t cb, const solve_limit_t& l, const solve_progress_t& progress) const
 {
+	search_limit_t limit(l);
 	for(int depth = 0; ; ++depth)
 	{
 		move_seq_t seq(depth);
 
 		search_info_t s;
-		s.cb    = cb;
+		s.cb    = make_node(packed_cube_t(cb));
+		s.cb.stamp = transposition.empty() ? 0 : transposition.next_stamp();
 		s.g     = 0;
 		s.seq   = &seq;
-		s.face  = 6;
+		s.state = move_automaton_t::start;
 		s.depth = depth;
 
-		if(depth < 11 || thread_num == 1) 
+		s.job   = nullptr;
+		s.limit = &limit;
+
+		bool found;
+		if(depth < 11 || thread_num == 1)
 		{
-			s.tid = -1;
-			if(search(s)) 
-				return *s.seq;
+			found = search(s) && !limit.stopped();
 		} else {
 			using namespace std::placeholders;
-			if(search_multi_thread(thread_num, s, std::bind(&krof_t::search, this, _1)))
-				return *s.seq;
+			found = search_multi_thread(thread_num, s,
+				std::bind(&krof_t::search, this, _1));
 		}
+
+		if(found)
+		{
+			move_stats.learn(*s.seq);
+			return { solve_result_t::solved, *s.seq, depth, limit.node_count() };
+		}
+
+		if(limit.stopped())
+			return { limit.status(), {}, depth, limit.node_count() };
+
+		if(progress)
+			progress({ solve_result_t::searching, {}, depth + 1, limit.node_count() });
 	}
+}
 
-	return {};
+template<typename Table, int K>
+bool krof_t<Table, K>::search(const search_info_t& s) const
+{
+	return search_ida(s, [this](const search_info_t& u, child_t* out) {
+		return expand(u, out);
+	} );
 }
 
-bool krof_t::search(const search_info_t& s) const
+/* the children not pruned are stored to out */
+template<typename Table, int K>
+int krof_t<Table, K>::expand(const search_info_t& s, child_t* out) const
 {
 #ifdef DEBUG
 	static uint64_t cnt = 0;
 	if(++cnt % 10000 == 0)
 	{
 		std::printf("\rdepth = % 3d, node = % 12ld ", s.depth, cnt);
+		if(!transposition.empty())
+			std::printf("hit = % 10ld, miss = % 10ld ", transposition.hits(), transposition.misses());
 		std::fflush(stdout);
 	}
 #endif
 
-	if(s.tid >= 0 && *s.result_id >= 0)
-		return true;
-
-	search_info_t t = s;
-	t.g += 1;
-
+	// all the children are expanded and their entries are prefetched
+	// before any of them is read, so that the cache misses overlap.
+	// the corners table is the smallest one, so it is read first and
+	// the edges are only encoded for the children it does not prune
+	child_t *child = out;
+	int code[18][lookup_num], h[18], n = 0;
+	const uint32_t allowed = automaton.allowed(s.state);
 	for(int i = 0; i != 6; ++i)
 	{
-		if(i == s.face || disallow_faces[i] == s.face)
+		if((allowed >> i * 3 & 7) == 0)
 			continue;
 
-		cube_t cube = s.cb;
-		for(int j = 1; j <= 3; ++j)
+		node_t c = s.cb;
+		for(int j = 0; j != 3; ++j)
+		{
+			c.cube.rotate(i * 3);
+			if(dual) c.inverse.rotate_inverse(i * 3);
+			if((allowed >> (i * 3 + j) & 1) == 0)
+				continue;
+
+			child[n].cb = c;
+			child[n].move = i * 3 + j;
+			child[n].state = automaton.next(s.state, i * 3 + j);
+			code[n][0] = encode(c.cube, 0);
+			corners.prefetch(code[n++][0]);
+		}
+	}
+
+	const int bound = s.depth - s.g - 1;
+	for(int k = 0; k != n; ++k)
+	{
+		h[k] = estimate(s.cb, child[k].cb, code[k], 0, 1, bound);
+		if(h[k] <= bound)
+		{
+			encode_edges(child[k].cb.cube, code[k]);
+			for(int j = 1; j != lookup_num; ++j)
+				edges.prefetch(code[k][j]);
+		}
+	}
+
+	for(int k = 0; k != n; ++k)
+		if(h[k] <= bound)
+			h[k] = std::max(h[k], estimate(s.cb, child[k].cb, code[k], 1, lookup_num, bound));
+
+	// the inverse is looked up only if the cube is not pruned
+	if(dual)
+	{
+		for(int k = 0; k != n; ++k)
 		{
-			cube.rotate(face_t::face_type(i), 1);
-			int h = estimate(cube);
-			if(h + s.g + 1 <= s.depth)
+			if(h[k] + s.g + 1 <= s.depth)
 			{
-				(*s.seq)[s.g] = move_step_t{face_t::face_type(i), j};
+				encode(child[k].cb.inverse, code[k]);
+				prefetch(code[k]);
+			}
+		}
 
-				if(h == 0)
+		for(int k = 0; k != n; ++k)
+			if(h[k] + s.g + 1 <= s.depth)
+				h[k] = std::max(h[k], lookup(code[k]));
+	}
+
+	// the perimeter or the transposition table is probed only
+	// for the children not pruned
+	const int left = s.depth - s.g - 1;
+	const bool probe = left <= perimeter.depth();
+	const bool transpose = left >= transposition_depth && !transposition.empty();
+	uint64_t hash[18];
+	if(probe || transpose)
+	{
+		for(int k = 0; k != n; ++k)
+		{
+			if(h[k] + s.g + 1 <= s.depth)
+			{
+				hash[k] = child[k].cb.cube.hash();
+				if(probe)
 				{
-					for(auto& r : *s.seq)
-						if(r.second == 3)
-							r.second = -1;
+					perimeter.prefetch(hash[k]);
+					continue;
+				}
 
-					if(s.tid >= 0)
-						*s.result_id = s.tid;
+				// the subtree also depends on the state of the
+				// automaton, so the cubes of different states are
+				// different entries
+				hash[k] ^= child[k].state * 0x9e3779b97f4a7c15ull;
+				transposition.prefetch(hash[k]);
+			}
+		}
+	}
 
-					return true;
-				}
+	// the children kept are moved to the front in order
+	int num = 0;
+	for(int k = 0; k != n; ++k)
+	{
+		if(h[k] + s.g + 1 > s.depth)
+			continue;
 
-				t.cb   = cube;
-				t.face = i;
+		int m = child[k].move;
+		(*s.seq)[s.g] = move_step_t{face_t::face_type(m / 3), m % 3 + 1};
 
-				if(search(t))
-					return true;
-			}
+		bool solved = h[k] == 0;
+		if(probe)
+		{
+			// the distance of a cube not found is more than left
+			int d = perimeter.find(hash[k]);
+			if(d < 0 || d > left || !perimeter.path(child[k].cb.cube, d, s.seq->data() + s.g + 1))
+				continue;
+
+			s.seq->resize(s.g + 1 + d);
+			solved = true;
 		}
+
+		if(solved)
+		{
+			for(auto& r : *s.seq)
+				if(r.second == 3)
+					r.second = -1;
+			return -1;
+		}
+
+		if(transpose && !transposition.visit(hash[k], s.g + 1, s.cb.stamp))
+			continue;
+
+		if(num != k)
+		{
+			child[num] = child[k];
+			h[num] = h[k];
+		}
+		++num;
 	}
 
-	return false;
+	if(sort_children)
+		move_stats.sort(child, h, num);
+	return num;
 }
 
-int krof_t::estimate(const cube_t& c) const
+/* the code of the corners (k = 0) or the edges (k > 0) */
+template<typename Table, int K>
+int krof_t<Table, K>::encode(const packed_cube_t& c, int k) const
 {
-	return std::max<int>(
-		corners[encode_corners(c)],
-		estimate_edges(c)
-	);
+	int8_t buf[32];
+	if(k == 0)
+		return coder.encode_corners(c.getCornerBlock(buf));
+	return coder.encode_edges(c.getEdgeBlock(buf), k - 1);
 }
 
-void krof_t::init(const char* filename)
+template<typename Table, int K>
+int krof_t<Table, K>::lookup(int code, int k) const
 {
-	if(!filename)
+	return k ? edges.get(code) : corners.get(code);
+}
+
+/* the distance is found by moving towards the solved state if
+ * the table only stores it mod 3 */
+template<typename Table, int K>
+int krof_t<Table, K>::distance(const packed_cube_t& cube, int k) const
+{
+	packed_cube_t c = cube;
+	int code = encode(c, k);
+	if(Table::exact)
+		return lookup(code, k);
+
+	const int solved = encode(packed_cube_t(), k);
+	int d = 0;
+	for(int v = lookup(code, k); code != solved; ++d)
 	{
-		std::memset(edges1, 0xff, sizeof(edges1));
-		init_heuristic<false>(edges1, &krof_t::encode_edges1);
+		for(int m = 0; m != 18; ++m)
+		{
+			packed_cube_t next = c;
+			next.rotate(m);
+			int w = lookup(code = encode(next, k), k);
+			if(w == (v + 2) % 3)
+			{
+				c = next;
+				v = w;
+				break;
+			}
+		}
+	}
+
+	return d;
+}
+
+template<typename Table, int K>
+typename krof_t<Table, K>::node_t krof_t<Table, K>::make_node(const packed_cube_t& cube) const
+{
+	node_t u;
+	u.cube = cube;
+	u.inverse = packed_cube_t(cube.unpack().inverse());
+	for(int k = 0; k != lookup_num; ++k)
+		u.h[k] = distance(cube, k);
+	return u;
+}
+
+/* the codes of the corners and all the groups of edges */
+template<typename Table, int K>
+void krof_t<Table, K>::encode(const packed_cube_t& c, int *code) const
+{
+	code[0] = encode(c, 0);
+	encode_edges(c, code);
+}
+
+/* the codes of the groups of edges, code[0] is not changed */
+template<typename Table, int K>
+void krof_t<Table, K>::encode_edges(const packed_cube_t& c, int *code) const
+{
+	int8_t buf[32];
+	block_info_t eb = c.getEdgeBlock(buf);
+	for(int k = 1; k != lookup_num; ++k)
+		code[k] = coder.encode_edges(eb, k - 1);
+}
 
-		std::memset(edges2, 0xff, sizeof(edges2));
-		init_heuristic<false>(edges2, &krof_t::encode_edges2);
+template<typename Table, int K>
+void krof_t<Table, K>::prefetch(const int *code) const
+{
+	corners.prefetch(code[0]);
+	for(int k = 1; k != lookup_num; ++k)
+		edges.prefetch(code[k]);
+}
 
-		std::memset(corners, 0xff, sizeof(corners));
-		init_heuristic<false>(corners, &krof_t::encode_corners);
-	} else {
-		std::ifstream ifs(filename, std::ios::binary);
-		ifs.read(reinterpret_cast<char*>(edges1), edges_size);
-		ifs.read(reinterpret_cast<char*>(edges2), edges_size);
-		ifs.read(reinterpret_cast<char*>(corners), corners_size);
+/* the max of the entries, only used if the tables are exact */
+template<typename Table, int K>
+int krof_t<Table, K>::lookup(const int *code) const
+{
+	int h = corners.get(code[0]);
+	for(int k = 1; k != lookup_num; ++k)
+		h = std::max(h, edges.get(code[k]));
+	return h;
+}
+
+/* the max of the distances of the tables [begin, end), it returns once
+ * it is more than bound, and the other distances of c are not set since
+ * the child is pruned */
+template<typename Table, int K>
+int krof_t<Table, K>::estimate(const node_t& parent, node_t& c, const int *code, int begin, int end, int bound) const
+{
+	int h = 0;
+	for(int k = begin; k != end && h <= bound; ++k)
+	{
+		c.h[k] = Table::next_distance(parent.h[k], lookup(code[k], k));
+		h = std::max<int>(h, c.h[k]);
 	}
+
+	return h;
 }
 
-void krof_t::save(const char* filename) const
+template<int K>
+void krof_coder_t<K>::init(const uint32_t *edges_sym_table)
 {
-	std::ofstream ofs(filename, std::ios::binary);
-	ofs.write(reinterpret_cast<const char*>(edges1), edges_size);
-	ofs.write(reinterpret_cast<const char*>(edges2), edges_size);
-	ofs.write(reinterpret_cast<const char*>(corners), corners_size);
+	static const int8_t corners_group[] = { 0, 1, 2, 3, 4, 5, 6, 7 };
+	const int8_t *group = group_t::blocks;
+
+	std::vector<int> syms;
+	for(int s = 0; s != symmetry_t::count; ++s)
+		syms.push_back(s);
+	corners_sym.init(corners_group, syms);
+
+	syms.clear();
+	for(int s = 0; s != symmetry_t::count; ++s)
+	{
+		bool keep = true;
+		for(int k = 0; k != K; ++k)
+			keep = keep && std::count(group, group + K,
+				symmetry_t::edge_piece[s][int(group[k])]);
+		if(keep) syms.push_back(s);
+	}
+
+	edges_sym.init(group, syms, edges_sym_table);
+
+	for(int j = 0; j != image_num; ++j)
+	{
+		int s0 = symmetry_t::find(group_t::images[j]);
+		for(int p = 0; p != 12; ++p)
+			for(int q = 0; q != 12; ++q)
+			{
+				int k = edges_sym.group_index(symmetry_t::edge_piece[s0][q]);
+				edges_scan[j][p][q][0] = k >= 0 ? k : K;
+				edges_scan[j][p][q][1] = symmetry_t::edge_pos[s0][p];
+				edges_scan[j][p][q][2] = symmetry_t::edge_orient[s0][p][q][0];
+			}
+	}
+
+	for(int s : syms)
+		for(int v = 0; v != edges_orient_size; ++v)
+		{
+			int8_t pos[K], ori[K];
+			for(int k = 0; k != K; ++k)
+			{
+				pos[k] = group[k];
+				ori[k] = (v >> k) & 1;
+			}
+
+			// the orientation xor of the solved positions is zero
+			edges_ori_conj[s][v] = encode_edges_orient(pos, ori, s);
+		}
 }
 
-int krof_t::estimate_edges(const cube_t& c) const
+template<typename Table, int K>
+void krof_t<Table, K>::init(const char* filename)
 {
-	block_info_t eb = c.getEdgeBlock();
+	// the symmetry lookup of the edges is as large as the edges table
+	// for 8 edges and slow to build, so it is also mapped from the file
+	bool opened = filename && file.open(filename, "krof", table_version);
+	const uint8_t *sym = opened ? file.find("edges_sym", 32, coder_t::edges_perm_size) : nullptr;
+	coder.init(reinterpret_cast<const uint32_t*>(sym));
 
-	int t;
-	int v1 = 0, v2 = 0;
-	int8_t perm1[6], perm2[6];
-	for(int i = 0; i != 12; ++i)
+	if(perimeter_depth > 0)
+		perimeter.init(perimeter_depth);
+	if(transposition_mb > 0)
+		transposition.init(size_t(transposition_mb) << 20);
+
+	int corners_size = coder.corners_size();
+	int edges_size = coder.edges_size();
+
+	if(opened)
 	{
-		if(eb.first[i] < 6)
+		const uint8_t *e = file.find("edges", Table::bits, edges_size);
+		const uint8_t *c = file.find("corners", Table::bits, corners_size);
+		if(e && c)
 		{
-			t = eb.first[i];
-			perm1[t] = i;
-			v1 |= eb.second[i] << t;
-		} else {
-			t = eb.first[i] - 6;
-			perm2[t] = i;
-			v2 |= eb.second[i] << t;
+			edges.attach(e, edges_size);
+			corners.attach(c, corners_size);
+			replicate();
+			return;
 		}
 	}
 
-	return std::max(
-		edges1[v1 + (encode_perm<12, 6>(perm1, factorial_12) << 6)],
-		edges2[v2 + (encode_perm<12, 6>(perm2, factorial_12) << 6)]
-	);
+	// the file is missing or does not match, build the tables. the
+	// file is kept if the symmetry lookup is mapped from it
+	if(!sym) file.close();
+
+	using namespace std::placeholders;
+
+	auto build_corners = [this, corners_size] {
+		pruning_table_t<4> table;
+		init_heuristic<false, packed_cube_t>(table, corners_size, [this](const packed_cube_t& c) {
+			int8_t buf[32];
+			return coder.encode_corners(c.getCornerBlock(buf));
+		}, std::bind(&coder_t::decode_corners, &coder, _1) );
+		corners.assign(std::move(table));
+	};
+
+	// the corners table is much smaller, so it is built by one of the
+	// threads while the edges table is built by the others. get()
+	// rethrows the exception of the corners, e.g. bad_alloc
+	std::future<void> corners_done;
+	if(thread_num > 1)
+		corners_done = std::async(std::launch::async, build_corners);
+	else build_corners();
+
+	pruning_table_t<4> table;
+	init_heuristic<false, packed_cube_t>(table, edges_size, [this](const packed_cube_t& c) {
+		int8_t buf[32];
+		return coder.encode_edges(c.getEdgeBlock(buf), 0);
+	}, std::bind(&coder_t::decode_edges, &coder, _1), std::max(1, thread_num - 1));
+	edges.assign(std::move(table));
+
+	if(corners_done.valid())
+		corners_done.get();
+	replicate();
 }
 
-int krof_t::encode_edges1(const cube_t& c)
+template<typename Table, int K>
+void krof_t<Table, K>::replicate()
 {
-	block_info_t eb = c.getEdgeBlock();
+	coder.replicate();
+	corners.replicate();
+	edges.replicate();
+}
+
+template<typename Table, int K>
+bool krof_t<Table, K>::save(const char* filename) const
+{
+	return table_file_t::save(filename, "krof", table_version, {
+		{ "edges", Table::bits, edges.size(), edges.data(), Table::bytes(edges.size()) },
+		{ "corners", Table::bits, corners.size(), corners.data(), Table::bytes(corners.size()) },
+		{ "edges_sym", 32, coder_t::edges_perm_size,
+			reinterpret_cast<const uint8_t*>(coder.edges_sym_table()),
+			coder_t::edges_perm_size * sizeof(uint32_t) }
+	} );
+}
 
-	int t, v = 0;
-	int8_t perm[6];
+/* the edges of the group after conjugating by the j-th image,
+ * then reduced by the symmetries keeping the group */
+template<int K>
+int krof_coder_t<K>::encode_edges(block_info_t eb, int j) const
+{
+	// the blocks not in the group are written to pos[K] and ori[K]
+	int8_t pos[K + 1], ori[K + 1];
 	for(int i = 0; i != 12; ++i)
 	{
-		if(eb.first[i] < 6)
-		{
-			t = eb.first[i];
-			perm[t] = i;
-			v |= eb.second[i] << t;
-		}
+		const int8_t *e = edges_scan[j][i][int(eb.first[i])];
+		pos[int(e[0])] = e[1];
+		ori[int(e[0])] = eb.second[i] ^ e[2];
+	}
+
+	uint32_t t = edges_sym.lookup(encode_perm<12, K>(pos, factorial_12));
+	int s = t & 0x3f;
+
+	// the orientation of the group after conjugating by s
+	int bits = 0;
+	for(int k = 0; k != K; ++k)
+		bits |= (ori[k] ^ symmetry_t::edge_orient[s][int(pos[k])][int(group_t::blocks[k])][0]) << k;
+
+	int v = edges_ori_conj[s][bits];
+	if(t & 0x80)
+	{
+		for(int8_t u : edges_sym.stabilizer(t >> 8))
+			v = std::min(v, encode_edges_orient(pos, ori, symmetry_t::multiply[int(u)][s]));
 	}
 
-	return v + (encode_perm<12, 6>(perm, factorial_12) << 6);
+	return (t >> 8) * edges_orient_size + v;
 }
 
-int krof_t::encode_edges2(const cube_t& c)
+template<int K>
+int krof_coder_t<K>::encode_edges_orient(const int8_t *pos, const int8_t *ori, int s) const
 {
-	block_info_t eb = c.getEdgeBlock();
+	int v = 0;
+	for(int k = 0; k != K; ++k)
+	{
+		int q = group_t::blocks[k];
+		int o = symmetry_t::edge_orient[s][int(pos[k])][q][int(ori[k])];
+		v |= o << edges_sym.group_index(symmetry_t::edge_piece[s][q]);
+	}
 
-	int t, v = 0;
-	int8_t perm[6];
-	for(int i = 0; i != 12; ++i)
+	return v;
+}
+
+template<int K>
+int krof_coder_t<K>::encode_corners(block_info_t cb) const
+{
+	int8_t pos[8], ori[8];
+	for(int i = 0; i != 8; ++i)
 	{
-		if(eb.first[i] >= 6)
-		{
-			t = eb.first[i] - 6;
-			perm[t] = i;
-			v |= eb.second[i] << t;
-		}
+		pos[int(cb.first[i])] = i;
+		ori[int(cb.first[i])] = cb.second[i];
+	}
+
+	uint32_t t = corners_sym.lookup(encode_perm<8, 7>(pos, factorial_8));
+	int s = t & 0x3f;
+
+	int v = encode_corners_orient(pos, ori, s);
+	if(t & 0x80)
+	{
+		for(int8_t u : corners_sym.stabilizer(t >> 8))
+			v = std::min(v, encode_corners_orient(pos, ori, symmetry_t::multiply[int(u)][s]));
 	}
 
-	return v + (encode_perm<12, 6>(perm, factorial_12) << 6);
+	return (t >> 8) * corners_orient_size + v;
 }
 
-int krof_t::encode_corners(const cube_t& c) 
+template<int K>
+int krof_coder_t<K>::encode_corners_orient(const int8_t *pos, const int8_t *ori, int s)
 {
-	static const int base0 = 2187; // 3^7
+	int8_t co[8];
+	for(int q = 0; q != 8; ++q)
+		co[int(symmetry_t::corner_piece[s][q])] =
+			symmetry_t::corner_orient[s][int(pos[q])][q][int(ori[q])];
 
-	block_info_t cb = c.getCornerBlock();
 	int v = 0;
 	for(int i = 0; i != 7; ++i)
-		v = v * 3 + cb.second[i];
+		v = v * 3 + co[i];
 
-	return v + encode_perm<8, 7>(cb.first, factorial_8) * base0;
+	return v;
+}
+
+/* the representative of the class with the orientation, the
+ * orientation of the last corner makes the twist valid */
+template<int K>
+packed_cube_t krof_coder_t<K>::decode_corners(int v) const
+{
+	int8_t pos[8], cp[8], co[8];
+	decode_perm<8, 7>(corners_sym.representative(v / corners_orient_size), pos, factorial_8);
+
+	int twist = 0;
+	v %= corners_orient_size;
+	for(int q = 6; q >= 0; --q, v /= 3)
+	{
+		cp[int(pos[q])] = q;
+		co[int(pos[q])] = v % 3;
+		twist += v % 3;
+	}
+
+	cp[int(pos[7])] = 7;
+	co[int(pos[7])] = (3 - twist % 3) % 3;
+
+	cube_t c;
+	block_info_t eb = c.getEdgeBlock();
+	return packed_cube_t(cube_t(cp, co, eb.first, eb.second));
+}
+
+/* the representative of the class with the orientation, the
+ * blocks not in the group fill the other positions */
+template<int K>
+packed_cube_t krof_coder_t<K>::decode_edges(int v) const
+{
+	int8_t pos[12], ep[12], eo[12];
+	decode_perm<12, K>(edges_sym.representative(v / edges_orient_size), pos, factorial_12);
+
+	for(int q = 0, k = K; q != 12; ++q)
+	{
+		int i = edges_sym.group_index(q);
+		if(i >= 0)
+		{
+			ep[int(pos[i])] = q;
+			eo[int(pos[i])] = (v >> i) & 1;
+		} else {
+			ep[int(pos[k])] = q;
+			eo[int(pos[k++])] = 0;
+		}
+	}
+
+	cube_t c;
+	block_info_t cb = c.getCornerBlock();
+	return packed_cube_t(cube_t(cb.first, cb.second, ep, eo));
+}
+
+template<int K>
+std::shared_ptr<algo_t> create(int thread_num, bool mod3_tables,
+	int perimeter_depth, int transposition_mb, bool sort_children)
+{
+	if(mod3_tables)
+		return std::make_shared<krof_t<pruning_table_t<2>, K>>(
+			thread_num, perimeter_depth, transposition_mb, sort_children);
+	return std::make_shared<krof_t<pruning_table_t<4>, K>>(
+		thread_num, perimeter_depth, transposition_mb, sort_children);
 }
 
 } // namespace __krof_algo_impl
 
-std::shared_ptr<algo_t> create_krof_algo(int thread_num)
+std::shared_ptr<algo_t> create_krof_algo(int thread_num, bool mod3_tables, int edges_group,
+	int perimeter_depth, int transposition_mb, bool sort_children)
 {
-	return std::make_shared<__krof_algo_impl::krof_t>(thread_num);
+	using namespace __krof_algo_impl;
+	switch(edges_group)
+	{
+		case 7: return create<7>(thread_num, mod3_tables, perimeter_depth, transposition_mb, sort_children);
+		case 8: return create<8>(thread_num, mod3_tables, perimeter_depth, transposition_mb, sort_children);
+		default: return create<6>(thread_num, mod3_tables, perimeter_depth, transposition_mb, sort_children);
+	}
 }
 
 } // namespace rubik_cube
@@ -14,6 +14,21 @@ cube_t::cube_t()
 		ep[i] = i;
 }
 
+cube_t::cube_t(const int8_t *cp, const int8_t *co, const int8_t *ep, const int8_t *eo)
+{
+	std::memcpy(this->cp, cp, sizeof(this->cp));
+	std::memcpy(this->co, co, sizeof(this->co));
+	std::memcpy(this->ep, ep, sizeof(this->ep));
+	std::memcpy(this->eo, eo, sizeof(this->eo));
+}
+
+cube_t::cube_t(const move_seq_t& seq)
+	: cube_t()
+{
+	for(const move_step_t& step : seq)
+		rotate(step.first, step.second);
+}
+
 void cube_t::rotate(face_t::face_type type, int count)
 {
 	static const int corner_rotate_map[2][6][4] = 
@@ -116,6 +131,56 @@ void cube_t::rotate(face_t::face_type type, int count)
 	}
 }
 
+cube_t cube_t::compose(const cube_t& a, const cube_t& b)
+{
+	cube_t c;
+	for(int i = 0; i != 8; ++i)
+	{
+		c.cp[i] = a.cp[b.cp[i]];
+		c.co[i] = a.co[b.cp[i]] + b.co[i];
+		if(c.co[i] >= 3) c.co[i] -= 3;
+	}
+
+	for(int i = 0; i != 12; ++i)
+	{
+		c.ep[i] = a.ep[b.ep[i]];
+		c.eo[i] = a.eo[b.ep[i]] ^ b.eo[i];
+	}
+
+	return c;
+}
+
+cube_t cube_t::inverse() const
+{
+	cube_t c;
+	for(int i = 0; i != 8; ++i)
+	{
+		c.cp[cp[i]] = i;
+		c.co[cp[i]] = co[i] ? 3 - co[i] : 0;
+	}
+
+	for(int i = 0; i != 12; ++i)
+	{
+		c.ep[ep[i]] = i;
+		c.eo[ep[i]] = eo[i];
+	}
+
+	return c;
+}
+
+bool cube_t::is_solved() const
+{
+	return *this == cube_t();
+}
+
+bool cube_t::operator == (const cube_t& r) const
+{
+	return std::memcmp(cp, r.cp, sizeof(cp)) == 0
+		&& std::memcmp(co, r.co, sizeof(co)) == 0
+		&& std::memcmp(ep, r.ep, sizeof(ep)) == 0
+		&& std::memcmp(eo, r.eo, sizeof(eo)) == 0;
+}
+
 block_t cube_t::getBlock(int level, int x, int y) const
 {
 	static const int corner_orient_map[][3] = 
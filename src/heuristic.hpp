@@ -2,17 +2,34 @@
 #define __HEURISTIC_HPP__
 
 #include "cube.h"
-#include <queue>
+#include "table_memory.hpp"
 #include <vector>
+#include <future>
+#include <atomic>
+#include <functional>
+#include <algorithm>
 #include <cstdint>
+#include <cstring>
 
 namespace rubik_cube
 {
-	constexpr static int disallow_faces[6] = { -1, 0, -1, 2, -1, 4 };
 	constexpr static int factorial_4[] = { 1, 4, 12, 24 };
 	constexpr static int factorial_8[] = { 1, 8, 56, 336, 1680, 6720, 20160, 40320 };
 	constexpr static int factorial_12[] = { 1, 12, 132, 1320, 11880, 95040, 665280, 3991680, 19958400, 79833600, 239500800, 479001600 };
 
+	/* the number of permutations encoded by encode_perm<N, S> */
+	template<int N, int S>
+	struct factorial
+	{
+		static const int value = N * factorial<N - 1, S - 1>::value;
+	};
+
+	template<int N>
+	struct factorial<N, 0>
+	{
+		static const int value = 1;
+	};
+
 	template<int N, int S>
 	inline int encode_perm(const int8_t *p, const int *k) 
 	{
@@ -33,54 +50,216 @@ namespace rubik_cube
 		return v;
 	}
 
-	template<bool IsGroup1, bool RecordState = false>
-	inline void init_heuristic(
-		int8_t *buf, 
-		int(*encoder)(const cube_t&),
-		std::vector<cube_t>* recorder = nullptr, 
-		const std::vector<cube_t>& init_state = { cube_t() } )
+	/* inverse of encode_perm, the first S elements are the decoded
+	 * permutation and the rest N - S elements are the unused ones */
+	template<int N, int S>
+	inline void decode_perm(int v, int8_t *p, const int *k)
 	{
-		std::queue<std::pair<cube_t, uint8_t>> que;
+		int elem[N];
 
-		for(const cube_t& c : init_state)
+		for(int i = 0; i != N; ++i)
+			elem[i] = i;
+
+		for(int i = 0; i != S; ++i)
 		{
-			buf[(*encoder)(c)] = 0;
-			que.push( { c, 0 | (6 << 4) } );
+			int t = v / k[i] % (N - i);
+			p[i] = elem[t];
+			elem[t] = elem[N - i - 1];
 		}
 
-		while(!que.empty())
+		for(int i = S; i != N; ++i)
+			p[i] = elem[i - S];
+	}
+
+	/* a pruning table with Bits bits per entry. when Bits = 8 or 4 the
+	 * entry is the distance, when Bits = 2 the entry is the distance 
+	 * mod 3, which is recovered by the distance of a neighbour, see 
+	 * next_distance. the entries which are not visited are unvisited.
+	 *
+	 * the entries are accessed by relaxed atomic operations, so that 
+	 * a table can be filled by several threads. a table may also use
+	 * read-only memory owned by others, e.g. a mapped file. the memory
+	 * owned by the table is backed by huge pages, see table_memory_t. */
+	template<int Bits>
+	class pruning_table_t
+	{
+	public:
+		static const int bits = Bits;
+		static const bool exact = Bits != 2;
+		static const int unvisited = (1 << Bits) - 1;
+	public:
+		pruning_table_t() = default;
+		pruning_table_t(const pruning_table_t&) = delete;
+		pruning_table_t& operator = (const pruning_table_t&) = delete;
+	public:
+		/* all the entries are unvisited */
+		void assign(int size)
 		{
-			auto u = que.front();
-			int face = u.second >> 4;
-			int step = u.second & 0xf;
+			this->count = size;
+			words.assign(bytes(size), 0xff);
+			ptr = words.data();
+			replicas.clear();
+		}
 
-			for(int i = 0; i != 6; ++i)
+		/* the distance of t is stored */
+		template<int B>
+		void assign(const pruning_table_t<B>& t)
+		{
+			assign(t.size());
+			for(int i = 0; i != count; ++i)
 			{
-				if(i == face || disallow_faces[i] == face)
-					continue;
+				int v = t.get(i);
+				set(i, v == t.unvisited ? unvisited : exact ? v : v % 3);
+			}
+		}
+
+		void assign(pruning_table_t&& t)
+		{
+			count = t.count;
+			words.swap(t.words);
+			ptr = words.data();
+			replicas.clear();
+		}
 
-				cube_t c = u.first;
-				for(int j = 0; j != 3; ++j)
+		/* use the data of bytes(size) bytes without copying it,
+		 * which should be alive as long as the table */
+		void attach(const uint8_t *data, int size)
+		{
+			count = size;
+			words.clear();
+			ptr = data;
+			replicas.clear();
+		}
+
+		/* copy the filled table to each NUMA node, the entries should
+		 * not be set after that */
+		void replicate()
+		{
+			replicas.assign(ptr, bytes(count));
+		}
+
+		int get(int i) const
+		{
+			uint8_t w = __atomic_load_n(&replicas.local(ptr)[i / per_word], __ATOMIC_RELAXED);
+			return (w >> (i % per_word * Bits)) & unvisited;
+		}
+
+		void set(int i, int v)
+		{
+			uint8_t& w = words.data()[i / per_word];
+			int shift = i % per_word * Bits;
+			w = (w & ~(unvisited << shift)) | v << shift;
+		}
+
+		/* the entry is read later by get */
+		void prefetch(int i) const
+		{
+			__builtin_prefetch(replicas.local(ptr) + i / per_word);
+		}
+
+		/* set the entry to v if it is unvisited */
+		bool visit(int i, int v)
+		{
+			uint8_t *w = words.data() + i / per_word;
+			int shift = i % per_word * Bits;
+			uint8_t old = __atomic_load_n(w, __ATOMIC_RELAXED), value;
+			do {
+				if(((old >> shift) & unvisited) != unvisited)
+					return false;
+				value = (old & ~(unvisited << shift)) | v << shift;
+			} while(!__atomic_compare_exchange_n(w, &old, value, 
+				true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+			return true;
+		}
+
+		/* the distance of a neighbour of the code, whose distance is d */
+		static int next_distance(int d, int v)
+		{
+			if(exact) return v;
+			return d + (v - d % 3 + 4) % 3 - 1;
+		}
+
+		int size() const { return count; }
+
+		/* the raw data, used to save and load the table */
+		static size_t bytes(int size) { return (size_t(size) + per_word - 1) / per_word; }
+		const uint8_t* data() const { return ptr; }
+	private:
+		static const int per_word = 8 / Bits;
+		int count = 0;
+		table_memory_t words;
+		const uint8_t *ptr = nullptr;
+		table_replicas_t replicas;
+	};
+
+	/* Cube should have a rotate(face_t::face_type, int) method,
+	 * Encoder: int(const Cube&), Decoder: Cube(int), the decoded 
+	 * cube of a code should be encoded to the same code.
+	 *
+	 * the table should be exact, it is filled level by level, the 
+	 * codes of a level are decoded and expanded, so no memory is 
+	 * needed except the table. each level is shared by thread_num
+	 * threads in chunks. */
+	template<bool IsGroup1, typename Cube, typename Table, typename Encoder, typename Decoder>
+	inline void init_heuristic(
+		Table& table, 
+		int size,
+		const Encoder& encoder,
+		const Decoder& decoder,
+		int thread_num = 1,
+		const std::vector<Cube>& init_state = { Cube() } )
+	{
+		static_assert(Table::exact, "the distance should be exact");
+		static const int chunk_size = 1 << 16;
+
+		table.assign(size);
+		for(const Cube& c : init_state)
+			table.visit(encoder(c), 0);
+
+		auto expand = [&](int step, std::atomic<int>& next) -> bool {
+			bool updated = false;
+			for(int begin; (begin = next.fetch_add(chunk_size)) < size; )
+			{
+				int end = std::min(size - begin, chunk_size) + begin;
+				for(int v = begin; v != end; ++v)
 				{
-					if(IsGroup1 && i >= 2)
-					{
-						if(j) break;
-						c.rotate(face_t::face_type(i), 2);
-					} else {
-						c.rotate(face_t::face_type(i), 1);
-					}
+					if(table.get(v) != step)
+						continue;
 
-					int code = (*encoder)(c);
-					if(buf[code] == -1)
+					const Cube u = decoder(v);
+					for(int i = 0; i != 6; ++i)
 					{
-						buf[code] = step + 1;
-						que.push( { c, (step + 1) | (i << 4) } );
-						if(RecordState) recorder->push_back(c);
+						Cube c = u;
+						for(int j = 0; j != 3; ++j)
+						{
+							if(IsGroup1 && i >= 2)
+							{
+								if(j) break;
+								c.rotate(face_t::face_type(i), 2);
+							} else {
+								c.rotate(face_t::face_type(i), 1);
+							}
+
+							if(table.visit(encoder(c), step + 1))
+								updated = true;
+						}
 					}
 				}
 			}
 
-			que.pop();
+			return updated;
+		};
+
+		for(int step = 0, updated = 1; updated; ++step)
+		{
+			std::atomic<int> next(0);
+			std::vector<std::future<bool>> results;
+			for(int i = 1; i < thread_num; ++i)
+				results.push_back(std::async(std::launch::async, expand, step, std::ref(next)));
+
+			updated = expand(step, next);
+			for(auto& r : results)
+				updated |= r.get();
 		}
 	}
 } // namespace rubik_rube
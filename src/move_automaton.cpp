@@ -0,0 +1,167 @@
+#include "move_automaton.hpp"
+#include "packed_cube.hpp"
+#include <map>
+
+namespace rubik_cube
+{
+
+namespace
+{
+	/* the hashes of the cubes reached, by linear probing */
+	class hash_set_t
+	{
+	public:
+		explicit hash_set_t(int bits) : slots(size_t(1) << bits, 0), mask((1u << bits) - 1) {}
+
+		/* returns false if the hash is already inserted */
+		bool insert(uint64_t hash)
+		{
+			hash |= 1;
+			for(size_t i = hash & mask; ; i = (i + 1) & mask)
+			{
+				if(slots[i] == hash)
+					return false;
+				if(slots[i] == 0)
+				{
+					slots[i] = hash;
+					return true;
+				}
+			}
+		}
+	private:
+		std::vector<uint64_t> slots;
+		uint64_t mask;
+	};
+}
+
+const move_automaton_t& move_automaton_t::shared()
+{
+	static const move_automaton_t automaton;
+	return automaton;
+}
+
+move_automaton_t::move_automaton_t()
+{
+	// canonical[n][w] is set if the sequence w of n moves (a number in
+	// base 18) is canonical. the prefixes of a canonical sequence are
+	// canonical, so the sequences are extended from the canonical ones
+	// in lexicographic order, the first one reaching a cube is canonical
+	std::vector<std::vector<bool>> canonical(window + 1);
+	std::vector<std::pair<int, packed_cube_t>> last = { { 0, packed_cube_t() } }, cur;
+
+	// about 0.62M cubes are within 5 moves
+	hash_set_t seen(21);
+	seen.insert(packed_cube_t().hash());
+
+	canonical[0].assign(1, true);
+	for(int n = 1; n <= window; ++n)
+	{
+		canonical[n].assign(canonical[n - 1].size() * 18, false);
+		cur.clear();
+		for(const auto& p : last)
+		{
+			for(int m = 0; m != 18; ++m)
+			{
+				packed_cube_t c = p.second;
+				c.rotate(m);
+				if(!seen.insert(c.hash()))
+					continue;
+
+				int w = p.first * 18 + m;
+				canonical[n][w] = true;
+				if(n != window)
+					cur.emplace_back(w, c);
+			}
+		}
+
+		last.swap(cur);
+	}
+
+	// a raw state is the last min(g, window - 1) moves, numbered by
+	// id[length][moves] in the order they are reached
+	std::vector<std::vector<int>> id(window);
+	for(int n = 0; n != window; ++n)
+		id[n].assign(canonical[n].size(), -1);
+
+	std::vector<std::pair<int, int>> raw = { { 0, 0 } };
+	std::vector<std::vector<int>> next_raw;
+	id[0][0] = 0;
+
+	const int window_size = canonical[window - 1].size();
+	for(size_t k = 0; k != raw.size(); ++k)
+	{
+		std::vector<int> row(18, -1);
+		for(int m = 0; m != 18; ++m)
+		{
+			int n = raw[k].first + 1, w = raw[k].second * 18 + m;
+			if(!canonical[n][w])
+				continue;
+
+			if(n == window)
+			{
+				n = window - 1;
+				w %= window_size;
+			}
+
+			if(id[n][w] < 0)
+			{
+				id[n][w] = raw.size();
+				raw.emplace_back(n, w);
+			}
+
+			row[m] = id[n][w];
+		}
+
+		next_raw.push_back(row);
+	}
+
+	// the states accepting the same sequences are merged, starting
+	// from the classes of the moves accepted
+	const int raw_num = raw.size();
+	std::vector<int> cls(raw_num);
+	for(int k = 0; k != raw_num; ++k)
+	{
+		uint32_t mask = 0;
+		for(int m = 0; m != 18; ++m)
+			if(next_raw[k][m] >= 0)
+				mask |= 1u << m;
+		cls[k] = mask;
+	}
+
+	for(size_t cls_num = 0; ; )
+	{
+		// the classes are numbered in the order of the raw states,
+		// so the start state is the class 0
+		std::map<std::vector<int>, int> index;
+		std::vector<int> refined(raw_num);
+		for(int k = 0; k != raw_num; ++k)
+		{
+			std::vector<int> sig(1, cls[k]);
+			for(int m = 0; m != 18; ++m)
+				sig.push_back(next_raw[k][m] < 0 ? -1 : cls[next_raw[k][m]]);
+			refined[k] = index.emplace(sig, index.size()).first->second;
+		}
+
+		cls.swap(refined);
+		if(index.size() == cls_num)
+			break;
+		cls_num = index.size();
+	}
+
+	for(int k = 0; k != raw_num; ++k)
+	{
+		size_t c = cls[k];
+		if(c != masks.size())
+			continue;
+
+		masks.push_back(0);
+		for(int m = 0; m != 18; ++m)
+		{
+			int t = next_raw[k][m];
+			table.push_back(t < 0 ? -1 : cls[t]);
+			if(t >= 0) masks.back() |= 1u << m;
+		}
+	}
+}
+
+} // namespace rubik_cube
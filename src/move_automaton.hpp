@@ -0,0 +1,56 @@
+/**
+    Automaton of the canonical move sequences used by the searching.
+ **/
+#ifndef __MOVE_AUTOMATON_HPP__
+#define __MOVE_AUTOMATON_HPP__
+
+#include <cstdint>
+#include <vector>
+
+namespace rubik_cube
+{
+
+/*
+ * a sequence of moves is canonical if no shorter sequence or equally
+ * long sequence less in lexicographic order reaches the same cube. the
+ * first canonical sequence among the solutions of a length is the one
+ * whose windows of window moves are all canonical, so the searching
+ * only follows the moves accepted by this automaton, which reads the
+ * last window - 1 moves.
+ *
+ * it is generated from all the canonical sequences of at most window
+ * moves and then minimized. besides the same face and the order of the
+ * opposite faces, it removes e.g. D2 B2 F2 U2 = U2 B2 F2 D2. the
+ * branching factor is reduced from 13.35 to 13.30, i.e. about 5% fewer
+ * nodes at depth 17.
+ */
+class move_automaton_t
+{
+public:
+	/* the length of the windows checked */
+	static const int window = 5;
+
+	/* the state before any move */
+	static const int start = 0;
+public:
+	/* built on the first call */
+	static const move_automaton_t& shared();
+
+	/* the state after the move m (face * 3 + count - 1),
+	 * or -1 if the sequence is not canonical */
+	int next(int state, int m) const { return table[state * 18 + m]; }
+
+	/* the bits of the moves accepted after the state */
+	uint32_t allowed(int state) const { return masks[state]; }
+
+	int size() const { return masks.size(); }
+private:
+	move_automaton_t();
+private:
+	std::vector<int16_t> table;
+	std::vector<uint32_t> masks;
+};
+
+} // namespace rubik_cube
+
+#endif // __MOVE_AUTOMATON_HPP__
@@ -0,0 +1,81 @@
+#include "packed_cube.hpp"
+
+namespace rubik_cube
+{
+
+packed_cube_t::move_t packed_cube_t::moves[18];
+
+// the bytes used by the corners and the edges
+const int8_t packed_cube_t::corner_lanes[16] = { -1, -1, -1, -1, -1, -1, -1, -1 };
+const int8_t packed_cube_t::edge_lanes[16] = { -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 };
+
+namespace
+{
+	/* the move is exactly the packed cube after rotating the 
+	 * solved one: the block at position i comes from position
+	 * perm[i] and its orientation is increased by orient[i] */
+	struct packed_moves_initializer_t
+	{
+		packed_moves_initializer_t()
+		{
+			for(int m = 0; m != 18; ++m)
+			{
+				cube_t c;
+				c.rotate(face_t::face_type(m / 3), m % 3 + 1);
+				block_info_t cb = c.getCornerBlock();
+				block_info_t eb = c.getEdgeBlock();
+
+				packed_cube_t::move_t& mv = packed_cube_t::moves[m];
+				std::memset(mv.corner_shuffle, 0x80, sizeof(mv.corner_shuffle));
+				std::memset(mv.edge_shuffle, 0x80, sizeof(mv.edge_shuffle));
+				std::memset(mv.corner_orient, 0, sizeof(mv.corner_orient));
+				std::memset(mv.edge_orient, 0, sizeof(mv.edge_orient));
+
+				for(int i = 0; i != 8; ++i)
+				{
+					mv.corner_shuffle[i] = cb.first[i];
+					mv.corner_orient[i] = cb.second[i] << 4;
+				}
+
+				for(int i = 0; i != 12; ++i)
+				{
+					mv.edge_shuffle[i] = eb.first[i];
+					mv.edge_orient[i] = eb.second[i] << 4;
+				}
+			}
+		}
+	} packed_moves_initializer;
+}
+
+packed_cube_t::packed_cube_t()
+{
+	std::memset(corners, 0, sizeof(corners));
+	std::memset(edges, 0, sizeof(edges));
+	for(int i = 0; i != 8; ++i)
+		corners[i] = i;
+	for(int i = 0; i != 12; ++i)
+		edges[i] = i;
+}
+
+packed_cube_t::packed_cube_t(const cube_t& c)
+{
+	block_info_t cb = c.getCornerBlock();
+	block_info_t eb = c.getEdgeBlock();
+
+	std::memset(corners, 0, sizeof(corners));
+	std::memset(edges, 0, sizeof(edges));
+	for(int i = 0; i != 8; ++i)
+		corners[i] = cb.first[i] | cb.second[i] << 4;
+	for(int i = 0; i != 12; ++i)
+		edges[i] = eb.first[i] | eb.second[i] << 4;
+}
+
+cube_t packed_cube_t::unpack() const
+{
+	int8_t cb[32], eb[32];
+	unpack_block(corners, cb);
+	unpack_block(edges, eb);
+	return cube_t(cb, cb + 16, eb, eb + 16);
+}
+
+} // namespace rubik_cube
@@ -0,0 +1,212 @@
+/**
+    Packed representation of Rubik's Cube used by the searching.
+ **/
+#ifndef __PACKED_CUBE_HPP__
+#define __PACKED_CUBE_HPP__
+
+#include "cube.h"
+#include <cstdint>
+#include <cstring>
+
+#ifdef __SSSE3__
+#include <tmmintrin.h>
+#endif
+
+namespace rubik_cube
+{
+
+/*
+ * the corners and the edges are stored in one 16-byte lane respectively,
+ * each byte is (position | orientation << 4) of the block, which has
+ * the same meaning as cube_t.
+ *
+ * a rotation is a byte shuffle of each lane followed by adding the
+ * orientation (mod 3) for corners and xoring the orientation for edges.
+ */
+class packed_cube_t
+{
+public:
+	struct move_t
+	{
+		int8_t corner_shuffle[16], corner_orient[16];
+		int8_t edge_shuffle[16], edge_orient[16];
+	};
+
+	/* indexed by face * 3 + count - 1 */
+	static move_t moves[18];
+public:
+	packed_cube_t();
+	explicit packed_cube_t(const cube_t&);
+public:
+	cube_t unpack() const;
+
+	/* buf should have at least 32 bytes, the permutation is stored
+	 * in buf[0, 16) and the orientation is stored in buf[16, 32) */
+	block_info_t getCornerBlock(int8_t *buf) const;
+	block_info_t getEdgeBlock(int8_t *buf) const;
+
+	/* rotate a face 90 * count degree clockwise */
+	void rotate(face_t::face_type type, int count = 1)
+	{
+		count &= 3;
+		if(count) rotate(int(type) * 3 + count - 1);
+	}
+
+	/* apply moves[m] */
+	void rotate(int m);
+
+	/* if this is the inverse of a cube c, it becomes the inverse of c
+	 * after rotating the face, i.e. the inverse move is applied to the
+	 * labels of the blocks instead of their positions */
+	void rotate_inverse(face_t::face_type type, int count = 1)
+	{
+		count &= 3;
+		if(count) rotate_inverse(int(type) * 3 + count - 1);
+	}
+
+	void rotate_inverse(int m);
+
+	/* 64-bit hash of the blocks, which is the same for equal cubes */
+	uint64_t hash() const
+	{
+		uint64_t c, e0;
+		uint32_t e1;
+		std::memcpy(&c, corners, 8);
+		std::memcpy(&e0, edges, 8);
+		std::memcpy(&e1, edges + 8, 4);
+
+		// the finalizer of splitmix64
+		uint64_t h = c * 0x9e3779b97f4a7c15ull ^ e0;
+		h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ull ^ e1;
+		h = (h ^ (h >> 27)) * 0x94d049bb133111ebull;
+		return h ^ (h >> 31);
+	}
+
+	bool operator == (const packed_cube_t& r) const
+	{
+		return std::memcmp(corners, r.corners, 8) == 0
+			&& std::memcmp(edges, r.edges, 12) == 0;
+	}
+private:
+	static void unpack_block(const int8_t *v, int8_t *buf);
+private:
+	int8_t corners[16], edges[16];
+	static const int8_t corner_lanes[16], edge_lanes[16];
+};
+
+#ifdef __SSSE3__
+
+inline void packed_cube_t::rotate(int m)
+{
+	const move_t& mv = moves[m];
+
+	__m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(corners));
+	c = _mm_shuffle_epi8(c, _mm_loadu_si128(reinterpret_cast<const __m128i*>(mv.corner_shuffle)));
+	c = _mm_add_epi8(c, _mm_loadu_si128(reinterpret_cast<const __m128i*>(mv.corner_orient)));
+	// orientation >= 3 iff the byte >= 0x30, otherwise the subtraction wraps
+	c = _mm_min_epu8(c, _mm_sub_epi8(c, _mm_set1_epi8(0x30)));
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(corners), c);
+
+	__m128i e = _mm_loadu_si128(reinterpret_cast<const __m128i*>(edges));
+	e = _mm_shuffle_epi8(e, _mm_loadu_si128(reinterpret_cast<const __m128i*>(mv.edge_shuffle)));
+	e = _mm_xor_si128(e, _mm_loadu_si128(reinterpret_cast<const __m128i*>(mv.edge_orient)));
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(edges), e);
+}
+
+/* the inverse move of m is the move m' = m - m % 3 + 2 - m % 3, its
+ * packed cube is indexed by the positions of the blocks, then the
+ * orientation of the blocks is added */
+inline void packed_cube_t::rotate_inverse(int m)
+{
+	const move_t& mv = moves[m - m % 3 + 2 - m % 3];
+	__m128i mask = _mm_set1_epi8(0x0f);
+
+	__m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(corners));
+	__m128i a = _mm_or_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(mv.corner_shuffle)),
+		_mm_loadu_si128(reinterpret_cast<const __m128i*>(mv.corner_orient)));
+	c = _mm_add_epi8(_mm_shuffle_epi8(a, _mm_and_si128(c, mask)), _mm_andnot_si128(mask, c));
+	c = _mm_min_epu8(c, _mm_sub_epi8(c, _mm_set1_epi8(0x30)));
+	c = _mm_and_si128(c, _mm_loadu_si128(reinterpret_cast<const __m128i*>(corner_lanes)));
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(corners), c);
+
+	__m128i e = _mm_loadu_si128(reinterpret_cast<const __m128i*>(edges));
+	a = _mm_or_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(mv.edge_shuffle)),
+		_mm_loadu_si128(reinterpret_cast<const __m128i*>(mv.edge_orient)));
+	e = _mm_xor_si128(_mm_shuffle_epi8(a, _mm_and_si128(e, mask)), _mm_andnot_si128(mask, e));
+	e = _mm_and_si128(e, _mm_loadu_si128(reinterpret_cast<const __m128i*>(edge_lanes)));
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(edges), e);
+}
+
+inline void packed_cube_t::unpack_block(const int8_t *v, int8_t *buf)
+{
+	__m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(v));
+	__m128i mask = _mm_set1_epi8(0x0f);
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(buf), _mm_and_si128(x, mask));
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(buf + 16),
+		_mm_and_si128(_mm_srli_epi16(x, 4), mask));
+}
+
+#else
+
+inline void packed_cube_t::rotate(int m)
+{
+	const move_t& mv = moves[m];
+
+	int8_t c[16], e[16];
+	for(int i = 0; i != 8; ++i)
+	{
+		c[i] = corners[mv.corner_shuffle[i]] + mv.corner_orient[i];
+		if(c[i] >= 0x30) c[i] -= 0x30;
+	}
+
+	for(int i = 0; i != 12; ++i)
+		e[i] = edges[mv.edge_shuffle[i]] ^ mv.edge_orient[i];
+
+	std::memcpy(corners, c, 8);
+	std::memcpy(edges, e, 12);
+}
+
+inline void packed_cube_t::rotate_inverse(int m)
+{
+	const move_t& mv = moves[m - m % 3 + 2 - m % 3];
+
+	for(int i = 0; i != 8; ++i)
+	{
+		int p = corners[i] & 0x0f;
+		corners[i] = (mv.corner_shuffle[p] | mv.corner_orient[p]) + (corners[i] & 0x30);
+		if(corners[i] >= 0x30) corners[i] -= 0x30;
+	}
+
+	for(int i = 0; i != 12; ++i)
+	{
+		int p = edges[i] & 0x0f;
+		edges[i] = (mv.edge_shuffle[p] | mv.edge_orient[p]) ^ (edges[i] & 0x10);
+	}
+}
+
+inline void packed_cube_t::unpack_block(const int8_t *v, int8_t *buf)
+{
+	for(int i = 0; i != 16; ++i)
+	{
+		buf[i] = v[i] & 0x0f;
+		buf[i + 16] = (v[i] >> 4) & 0x0f;
+	}
+}
+
+#endif
+
+inline block_info_t packed_cube_t::getCornerBlock(int8_t *buf) const
+{
+	unpack_block(corners, buf);
+	return { buf, buf + 16 };
+}
+
+inline block_info_t packed_cube_t::getEdgeBlock(int8_t *buf) const
+{
+	unpack_block(edges, buf);
+	return { buf, buf + 16 };
+}
+
+} // namespace rubik_cube
+
+#endif // __PACKED_CUBE_HPP__
@@ -0,0 +1,95 @@
+#include "perimeter.hpp"
+#include "move_automaton.hpp"
+#include <stdexcept>
+
+namespace rubik_cube
+{
+
+namespace
+{
+	// the number of cubes within d moves
+	const uint64_t cube_count[] = {
+		1, 19, 262, 3502, 46741, 621649, 8240087, 109043123
+	};
+}
+
+void perimeter_t::init(int depth)
+{
+	if(depth < 0 || depth >= int(sizeof(cube_count) / sizeof(cube_count[0])))
+		throw std::invalid_argument("perimeter_t: depth is out of range");
+
+	// the load factor is at most 1/2
+	uint64_t size = 1;
+	while(size < cube_count[depth] * 2)
+		size <<= 1;
+
+	memory.assign(size * sizeof(uint64_t), 0);
+	slots = reinterpret_cast<uint64_t*>(memory.data());
+	mask = size - 1;
+	max_depth = depth;
+
+	// the cubes are inserted by increasing distance, so each
+	// of them is inserted with its distance
+	for(int d = 0; d <= depth; ++d)
+		insert_all(packed_cube_t(), 0, move_automaton_t::start, d);
+}
+
+void perimeter_t::insert(uint64_t hash, int distance)
+{
+	uint64_t k = key(hash), i = hash & mask;
+	for(; slots[i]; i = (i + 1) & mask)
+		if((slots[i] & ~0xfull) == k)
+			return;
+	slots[i] = k | distance;
+}
+
+void perimeter_t::insert_all(const packed_cube_t& c, int g, int state, int distance)
+{
+	if(g == distance)
+	{
+		insert(c.hash(), distance);
+		return;
+	}
+
+	const move_automaton_t& automaton = move_automaton_t::shared();
+	const uint32_t allowed = automaton.allowed(state);
+	for(int i = 0; i != 6; ++i)
+	{
+		if((allowed >> i * 3 & 7) == 0)
+			continue;
+
+		packed_cube_t t = c;
+		for(int j = 0; j != 3; ++j)
+		{
+			t.rotate(i * 3);
+			int next = automaton.next(state, i * 3 + j);
+			if(next >= 0)
+				insert_all(t, g + 1, next, distance);
+		}
+	}
+}
+
+bool perimeter_t::path(packed_cube_t c, int distance, move_step_t *out) const
+{
+	for(int d = distance; d != 0; --d)
+	{
+		bool found = false;
+		for(int m = 0; m != 18 && !found; ++m)
+		{
+			packed_cube_t t = c;
+			t.rotate(m);
+			if(find(t.hash()) == d - 1)
+			{
+				*out++ = move_step_t{face_t::face_type(m / 3), m % 3 + 1};
+				c = t;
+				found = true;
+			}
+		}
+
+		if(!found) return false;
+	}
+
+	return c == packed_cube_t();
+}
+
+} // namespace rubik_cube
@@ -0,0 +1,68 @@
+/**
+    The cubes near the solved one, used to finish the searching.
+ **/
+#ifndef __PERIMETER_HPP__
+#define __PERIMETER_HPP__
+
+#include "cube.h"
+#include "packed_cube.hpp"
+#include "table_memory.hpp"
+#include <cstdint>
+
+namespace rubik_cube
+{
+
+/*
+ * a hash table of all the cubes within depth moves of the solved one,
+ * each entry is (the hash of the cube, the distance in the lowest 4
+ * bits), 0 is empty. a searching reaching a cube with at most depth
+ * moves left finishes at once: it is solved if the cube is found,
+ * otherwise its distance is larger than depth.
+ *
+ * the number of cubes within 5, 6 and 7 moves is about 0.62M, 8.2M
+ * and 109M, the table takes 8 to 16 bytes for each of them.
+ */
+class perimeter_t
+{
+public:
+	void init(int depth);
+	int depth() const { return max_depth; }
+
+	void prefetch(uint64_t hash) const
+	{
+		__builtin_prefetch(slots + (hash & mask));
+	}
+
+	/* the distance of the cube, or -1 if it is not found */
+	int find(uint64_t hash) const
+	{
+		uint64_t k = key(hash);
+		for(uint64_t i = hash & mask; slots[i]; i = (i + 1) & mask)
+			if((slots[i] & ~0xfull) == k)
+				return slots[i] & 0xf;
+		return -1;
+	}
+
+	/* the moves solving the cube are stored to out, returns false if
+	 * the cube is not found or the distance does not match (i.e. a
+	 * collision of the hash) */
+	bool path(packed_cube_t c, int distance, move_step_t *out) const;
+private:
+	static uint64_t key(uint64_t hash)
+	{
+		hash &= ~0xfull;
+		return hash ? hash : 0x10;
+	}
+
+	void insert(uint64_t hash, int distance);
+	void insert_all(const packed_cube_t&, int g, int state, int distance);
+private:
+	int max_depth = -1;
+	uint64_t mask = 0;
+	uint64_t *slots = nullptr;
+	table_memory_t memory;
+};
+
+} // namespace rubik_cube
+
+#endif // __PERIMETER_HPP__
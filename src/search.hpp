@@ -3,104 +3,347 @@
 
 #include "cube.h"
 #include "algo.h"
-#include "search.hpp"
-#include <thread>
-#include <future>
+#include "thread_pool.hpp"
 #include <atomic>
 #include <mutex>
+#include <vector>
+#include <utility>
+#include <functional>
 #include <condition_variable>
 
 namespace rubik_cube
 {
 
-struct search_info_t
+template<typename State>
+class search_job_t;
+
+/* solve_limit_t checked by each node of the searching, the clock is
+ * read once every 1024 checks of a thread. once it is expired, the
+ * search functions should return true at once, and the caller finds
+ * the reason by status() */
+class search_limit_t
+{
+public:
+	explicit search_limit_t(const solve_limit_t& limit)
+		: limit(limit), state(solve_result_t::solved), nodes(0) {}
+public:
+	bool expired()
+	{
+		static thread_local unsigned cnt = 0;
+		if(state.load(std::memory_order_relaxed) != solve_result_t::solved)
+			return true;
+
+		if(limit.cancel && limit.cancel->load(std::memory_order_relaxed))
+			state = solve_result_t::cancelled;
+		else if((++cnt & 0x3ff) == 0 && solve_limit_t::clock_t::now() >= limit.deadline)
+			state = solve_result_t::timeout;
+		else return false;
+
+		return true;
+	}
+
+	bool stopped() const { return state != solve_result_t::solved; }
+	solve_result_t::status_t status() const { return solve_result_t::status_t(state.load()); }
+
+	/* the nodes searched by all the threads */
+	void count(uint64_t n) { nodes.fetch_add(n, std::memory_order_relaxed); }
+	uint64_t node_count() const { return nodes.load(); }
+private:
+	const solve_limit_t& limit;
+	std::atomic<int> state;
+	std::atomic<uint64_t> nodes;
+};
+
+template<typename State>
+struct basic_search_info_t
 {
-	cube_t cb;
-	int g, face, depth;
+	State cb;
+	// state of move_automaton_t after the first g moves
+	int g, state, depth;
 
 	move_seq_t* seq;
 
-	int tid;
-	std::atomic<int>* result_id;
+	// nullptr if the search is not shared by threads
+	search_job_t<State>* job;
+	search_limit_t* limit;
 };
 
-template<typename SearchFunc>
-inline bool search_multi_thread(
-	int thread_num, 
-	const search_info_t& s,
-	SearchFunc search)
+typedef basic_search_info_t<cube_t> search_info_t;
+
+/*
+ * a search of one depth shared by the threads of the pool. a search
+ * function should
+ *   - return true at once if job->stopped() or limit->expired(),
+ *   - call job->finish(seq) when it finds a solution,
+ *   - call job->split(t) before searching the child t, the child is
+ *     searched by a task of the pool instead if it returns true.
+ *
+ * the subtrees are split only if some worker is idle, so the work
+ * is split again at any depth when the first subtrees are done. at
+ * most max_tasks split subtrees are submitted and not finished, so
+ * the job never takes more workers than that.
+ */
+template<typename State>
+class search_job_t
 {
-	search_info_t infos[18];
-	move_seq_t seqs[18];
+public:
+	typedef basic_search_info_t<State> info_t;
+	typedef std::function<bool(const info_t&)> search_t;
 
-	std::mutex cv_m;
-	std::condition_variable cv;
-	int working_thread = 0;
+	/* the subtrees are split only if at least split_depth moves remain */
+	static const int split_depth = 4;
+public:
+	search_job_t(thread_pool_t& pool, search_t search, int max_tasks)
+		: pool(pool), search(search), max_tasks(max_tasks), tasks(0),
+		  stop(false), pending(0), found(false) {}
+public:
+	bool stopped() const { return stop.load(std::memory_order_relaxed); }
+
+	/* only the first solution is kept */
+	void finish(const move_seq_t& seq)
+	{
+		std::lock_guard<std::mutex> lk(m);
+		if(!found)
+		{
+			found = true;
+			result = seq;
+		}
+
+		stop = true;
+	}
+
+	bool split(const info_t& t)
+	{
+		if(t.depth - t.g < split_depth || !pool.starving())
+			return false;
+
+		int n = tasks.load(std::memory_order_relaxed);
+		do if(n >= max_tasks) return false;
+		while(!tasks.compare_exchange_weak(n, n + 1));
+
+		{
+			std::lock_guard<std::mutex> lk(m);
+			++pending;
+		}
 
-	std::future<bool> results[18];
-	std::atomic<int> result_id;
-	result_id = -1;
+		info_t info = t;
+		move_seq_t seq = *t.seq;
+		pool.submit([this, info, seq]() mutable {
+			info.seq = &seq;
+			run(info, true);
+		} );
 
-	for(int i = 0; i != 6; ++i)
+		return true;
+	}
+
+	/* search s on this thread and wait for the split subtrees,
+	 * returns true and stores the solution to seq if found */
+	bool run_and_wait(const info_t& s, move_seq_t& seq)
 	{
-		cube_t cube = s.cb;
-		for(int j = 1; j <= 3; ++j)
+		info_t info = s;
+		info.job = this;
+
 		{
-			int id = i * 3 + j - 1;
-			cube.rotate(face_t::face_type(i), 1);
+			std::lock_guard<std::mutex> lk(m);
+			++pending;
+		}
+		run(info, false);
 
-			seqs[id].resize(s.depth);
-			seqs[id][0] = move_step_t{face_t::face_type(i), j};
+		// no task is pushed to the queue of this thread while waiting
+		while(!done() && pool.run_local())
+			continue;
 
-			infos[id]           = s;
-			infos[id].tid       = id;
-			infos[id].cb        = cube;
-			infos[id].seq       = seqs + id;
-			infos[id].g         = 1;
-			infos[id].face      = i;
-			infos[id].result_id = &result_id;
+		std::unique_lock<std::mutex> lk(m);
+		cv.wait(lk, [this] { return pending == 0; });
+		if(found) seq = result;
+		return found;
+	}
+private:
+	/* the job is destroyed once the waiting thread sees pending == 0,
+	 * so it is only changed and read under m, and the last task
+	 * notifies before it releases m */
+	void run(const info_t& info, bool task)
+	{
+		if(!stopped())
+			search(info);
+
+		if(task) --tasks;
+		std::lock_guard<std::mutex> lk(m);
+		if(--pending == 0)
+			cv.notify_all();
+	}
 
-			std::packaged_task<bool()> task {
-				[&, id] () -> bool {
+	bool done()
+	{
+		std::lock_guard<std::mutex> lk(m);
+		return pending == 0;
+	}
+private:
+	thread_pool_t& pool;
+	search_t search;
+	const int max_tasks;
+	std::atomic<int> tasks;
+	std::atomic<bool> stop;
 
-					std::unique_lock<std::mutex> lk(cv_m);
-					cv.wait(lk, [&] { 
-						return working_thread < thread_num; 
-					} );
+	// guarded by m
+	std::mutex m;
+	std::condition_variable cv;
+	int pending;
+	bool found;
+	move_seq_t result;
+};
 
-					++working_thread;
-					lk.unlock();
+/* a child to be searched by the move (face * 3 + count - 1) */
+template<typename State>
+struct search_child_t
+{
+	State cb;
+	int move, state;
+};
 
-					bool ret = search(infos[id]);
+/*
+ * the search of one depth by an explicit stack, which replaces the
+ * recursion of the search functions. the stack keeps only the children
+ * not searched yet of each level.
+ *
+ * Expand: int(const basic_search_info_t<State>& s, search_child_t<State>* out)
+ * stores the children of s to be searched to out (at most 18) in order
+ * and returns their number, or returns -1 if a child solves the cube,
+ * whose solution is written to *s.seq. it is called once for each node.
+ *
+ * the moves are written to *s.seq when the children are searched, and
+ * it follows the protocol of search_job_t, so it is also the search
+ * function of the split subtrees.
+ */
+template<typename State, typename Expand>
+inline bool search_ida(const basic_search_info_t<State>& s, Expand expand)
+{
+	struct frame_t
+	{
+		search_child_t<State> child[18];
+		int num, next;
+	};
 
-					{
-						std::lock_guard<std::mutex> lk(cv_m);
-						--working_thread;
-					}
+	// the nodes are added to the limit when it returns
+	struct counter_t
+	{
+		search_limit_t *limit;
+		uint64_t nodes;
+		~counter_t() { limit->count(nodes); }
+	};
 
-					cv.notify_one();
+	// a level is pushed for each move left, the deeper searches
+	// (never needed by the solvers) take their stack from the heap
+	static const int max_depth = 32;
+	frame_t local[max_depth];
+	frame_t *stack = local;
+	std::vector<frame_t> heap;
+	if(s.depth - s.g >= max_depth)
+	{
+		heap.resize(s.depth - s.g + 1);
+		stack = heap.data();
+	}
 
-					return ret;
-				}
-			};
+	if(s.limit->expired() || (s.job && s.job->stopped()))
+		return true;
 
-			results[id] = task.get_future();
+	counter_t counter = { s.limit, 1 };
+	basic_search_info_t<State> t = s;
+	int top = 0;
+	stack[0].num = expand(s, stack[0].child);
+	stack[0].next = 0;
 
-			std::thread{ std::move(task) }.detach();
+	while(stack[top].num >= 0)
+	{
+		frame_t& f = stack[top];
+		if(f.next == f.num)
+		{
+			if(top-- == 0)
+				return false;
+			continue;
 		}
+
+		const search_child_t<State>& c = f.child[f.next++];
+		t.cb    = c.cb;
+		t.g     = s.g + top + 1;
+		t.state = c.state;
+		(*s.seq)[t.g - 1] = move_step_t{face_t::face_type(c.move / 3), c.move % 3 + 1};
+
+		if(s.job && s.job->split(t))
+			continue;
+
+		if(s.limit->expired() || (s.job && s.job->stopped()))
+			return true;
+
+		++top;
+		++counter.nodes;
+		stack[top].num = expand(t, stack[top].child);
+		stack[top].next = 0;
 	}
 
-	cv.notify_all();
+	if(s.job)
+		s.job->finish(*s.seq);
+	return true;
+}
 
-	for(auto& fu : results)
-		fu.wait();
+/*
+ * the moves of the solutions found. if the children are sorted by their
+ * estimates, which finds a solution of the last depth sooner, the ones
+ * of the same estimate are sorted by the decreasing hits of their moves.
+ */
+class move_stats_t
+{
+public:
+	move_stats_t()
+	{
+		for(auto& h : hits)
+			h = 0;
+	}
+public:
+	void learn(const move_seq_t& seq)
+	{
+		for(const move_step_t& step : seq)
+			hits[step.first * 3 + (step.second + 3) % 4].fetch_add(1, std::memory_order_relaxed);
+	}
 
-	if(result_id >= 0)
+	template<typename State>
+	void sort(search_child_t<State>* child, const int* h, int n) const
 	{
-		*s.seq = seqs[result_id];
-		return true;
-	} else return false;
+		uint64_t key[18];
+		for(int k = 0; k != n; ++k)
+			key[k] = uint64_t(h[k]) << 32 | ~hits[child[k].move].load(std::memory_order_relaxed);
+
+		// insertion sort, there are at most 18 children
+		for(int k = 1; k < n; ++k)
+		{
+			for(int j = k; j != 0 && key[j] < key[j - 1]; --j)
+			{
+				std::swap(key[j], key[j - 1]);
+				std::swap(child[j], child[j - 1]);
+			}
+		}
+	}
+private:
+	std::atomic<uint32_t> hits[18];
+};
+
+/* SearchFunc: bool(const basic_search_info_t<State>&), the search is
+ * run by this thread and at most thread_num - 1 workers of the shared
+ * pool at a time, returns false if no solution is found or s.limit is
+ * expired */
+template<typename State, typename SearchFunc>
+inline bool search_multi_thread(
+	int thread_num,
+	const basic_search_info_t<State>& s,
+	SearchFunc search)
+{
+	thread_pool_t& pool = thread_pool_t::shared();
+	pool.reserve(thread_num - 1);
+
+	search_job_t<State> job(pool, search, thread_num - 1);
+	return job.run_and_wait(s, *s.seq);
 }
+
 } // namespace rubik_cube
 
 #endif // __SEARCH_HPP__
@@ -0,0 +1,270 @@
+#include "symmetry.hpp"
+#include <cstring>
+
+namespace rubik_cube
+{
+
+int8_t symmetry_t::inverse[count];
+int8_t symmetry_t::multiply[count][count];
+int8_t symmetry_t::corner_pos[count][8];
+int8_t symmetry_t::corner_piece[count][8];
+int8_t symmetry_t::corner_orient[count][8][8][3];
+int8_t symmetry_t::edge_pos[count][12];
+int8_t symmetry_t::edge_piece[count][12];
+int8_t symmetry_t::edge_orient[count][12][12][2];
+
+namespace
+{
+	int sym_matrix[symmetry_t::count][3][3];
+
+	/* the direction of the faces */
+	const int face_dir[6][3] =
+	{
+		{ 0, 0, 1 }, { 0, 0, -1 }, // top, bottom
+		{ 0, 1, 0 }, { 0, -1, 0 }, // front, back
+		{ -1, 0, 0 }, { 1, 0, 0 }  // left, right
+	};
+
+	void apply(const int (&M)[3][3], const int *v, int *w)
+	{
+		for(int i = 0; i != 3; ++i)
+			w[i] = M[i][0] * v[0] + M[i][1] * v[1] + M[i][2] * v[2];
+	}
+
+	int find_face(const int *d)
+	{
+		for(int i = 0; i != 6; ++i)
+			if(!std::memcmp(face_dir[i], d, sizeof(face_dir[i])))
+				return i;
+		return -1;
+	}
+
+	/* the block at (level, x, y) is at (y - 1, x - 1, level - 1) */
+	void block_dir(const int *coord, int *v)
+	{
+		v[0] = coord[2] - 1;
+		v[1] = coord[1] - 1;
+		v[2] = coord[0] - 1;
+	}
+
+	void block_coord(const int *v, int *coord)
+	{
+		coord[0] = v[2] + 1;
+		coord[1] = v[1] + 1;
+		coord[2] = v[0] + 1;
+	}
+
+	/* the block at the position after the symmetry transformation */
+	block_t transform(const int (&M)[3][3], const block_t& b)
+	{
+		int8_t F[6], T[6];
+		std::memcpy(F, &b, sizeof(F));
+		std::memset(T, -1, sizeof(T));
+
+		for(int f = 0; f != 6; ++f)
+		{
+			if(F[f] == -1) continue;
+
+			int d[3], c[3];
+			apply(M, face_dir[f], d);
+			apply(M, face_dir[int(F[f])], c);
+			T[find_face(d)] = find_face(c);
+		}
+
+		return { T[0], T[1], T[2], T[3], T[4], T[5] };
+	}
+
+	template<int N, int O>
+	struct block_probe_t
+	{
+		int coord[N][3];  // (level, x, y) of a position
+		block_t blocks[N][N][O];
+
+		/* the position is found by changing the orientation of only one block */
+		void init(cube_t(*make)(int q, int o, int p))
+		{
+			for(int p = 0; p != N; ++p)
+			{
+				cube_t c = make(p, 1, p);
+				for(int l = 0; l != 3; ++l)
+					for(int x = 0; x != 3; ++x)
+						for(int y = 0; y != 3; ++y)
+						{
+							block_t b = c.getBlock(l, x, y);
+							int8_t F[6];
+							std::memcpy(F, &b, sizeof(F));
+
+							int n = 0;
+							for(int f = 0; f != 6; ++f)
+								n += F[f] != -1;
+
+							if((N == 8 && n != 3) || (N == 12 && n != 2))
+								continue;
+
+							for(int f = 0; f != 6; ++f)
+								if(F[f] != -1 && F[f] != f)
+								{
+									coord[p][0] = l;
+									coord[p][1] = x;
+									coord[p][2] = y;
+									break;
+								}
+						}
+			}
+
+			for(int p = 0; p != N; ++p)
+				for(int q = 0; q != N; ++q)
+					for(int o = 0; o != O; ++o)
+						blocks[p][q][o] = make(q, o, -1).getBlock(
+							coord[p][0], coord[p][1], coord[p][2]);
+		}
+
+		int find_pos(const int *c) const
+		{
+			for(int p = 0; p != N; ++p)
+				if(!std::memcmp(coord[p], c, sizeof(coord[p])))
+					return p;
+			return -1;
+		}
+
+		void find_block(int p, const block_t& b, int8_t& q, int8_t& o) const
+		{
+			for(q = 0; q != N; ++q)
+				for(o = 0; o != O; ++o)
+					if(!std::memcmp(&blocks[p][q][o], &b, sizeof(b)))
+						return;
+		}
+
+		void init_sym(const int (&M)[3][3], int8_t *pos, int8_t *piece, int8_t (*orient)[N][O])
+		{
+			for(int p = 0; p != N; ++p)
+			{
+				int v[3], w[3], c[3];
+				block_dir(coord[p], v);
+				apply(M, v, w);
+				block_coord(w, c);
+				pos[p] = find_pos(c);
+
+				for(int q = 0; q != N; ++q)
+					for(int o = 0; o != O; ++o)
+					{
+						int8_t q2, o2;
+						find_block(pos[p], transform(M, blocks[p][q][o]), q2, o2);
+						piece[q] = q2;
+						orient[p][q][o] = o2;
+					}
+			}
+		}
+	};
+
+	/* a cube with all positions filled by the block q with orientation o,
+	 * or only the block at position p is twisted when p >= 0 */
+	cube_t make_corners(int q, int o, int p)
+	{
+		int8_t cp[8], co[8];
+		for(int i = 0; i != 8; ++i)
+		{
+			cp[i] = p >= 0 ? i : q;
+			co[i] = p >= 0 ? (i == p) * o : o;
+		}
+
+		cube_t c;
+		block_info_t eb = c.getEdgeBlock();
+		return cube_t(cp, co, eb.first, eb.second);
+	}
+
+	cube_t make_edges(int q, int o, int p)
+	{
+		int8_t ep[12], eo[12];
+		for(int i = 0; i != 12; ++i)
+		{
+			ep[i] = p >= 0 ? i : q;
+			eo[i] = p >= 0 ? (i == p) * o : o;
+		}
+
+		cube_t c;
+		block_info_t cb = c.getCornerBlock();
+		return cube_t(cb.first, cb.second, ep, eo);
+	}
+
+	struct symmetry_initializer_t
+	{
+		symmetry_initializer_t()
+		{
+			static const int axis_perm[6][3] =
+			{
+				// the symmetries keeping the UD axis go first
+				{ 0, 1, 2 }, { 1, 0, 2 },
+				{ 0, 2, 1 }, { 1, 2, 0 }, { 2, 0, 1 }, { 2, 1, 0 }
+			};
+
+			int n = 0;
+			for(int i = 0; i != 6; ++i)
+				for(int sign = 0; sign != 8; ++sign, ++n)
+				{
+					std::memset(sym_matrix[n], 0, sizeof(sym_matrix[n]));
+					for(int j = 0; j != 3; ++j)
+						sym_matrix[n][j][axis_perm[i][j]] = (sign >> j) & 1 ? -1 : 1;
+				}
+
+			for(int s = 0; s != symmetry_t::count; ++s)
+				for(int t = 0; t != symmetry_t::count; ++t)
+				{
+					int P[3][3] = { { 0 } };
+					for(int i = 0; i != 3; ++i)
+						for(int j = 0; j != 3; ++j)
+							for(int k = 0; k != 3; ++k)
+								P[i][j] += sym_matrix[s][i][k] * sym_matrix[t][k][j];
+					if(P[0][0] == 1 && P[1][1] == 1 && P[2][2] == 1)
+						symmetry_t::inverse[s] = t;
+					symmetry_t::multiply[s][t] = symmetry_t::find(P);
+				}
+
+			block_probe_t<8, 3> corners;
+			block_probe_t<12, 2> edges;
+			corners.init(&make_corners);
+			edges.init(&make_edges);
+
+			for(int s = 0; s != symmetry_t::count; ++s)
+			{
+				corners.init_sym(sym_matrix[s], symmetry_t::corner_pos[s],
+					symmetry_t::corner_piece[s], symmetry_t::corner_orient[s]);
+				edges.init_sym(sym_matrix[s], symmetry_t::edge_pos[s],
+					symmetry_t::edge_piece[s], symmetry_t::edge_orient[s]);
+			}
+		}
+	} symmetry_initializer;
+}
+
+int symmetry_t::find(const int (&matrix)[3][3])
+{
+	for(int s = 0; s != count; ++s)
+		if(!std::memcmp(sym_matrix[s], matrix, sizeof(matrix)))
+			return s;
+	return -1;
+}
+
+cube_t symmetry_t::conjugate(const cube_t& c, int s)
+{
+	block_info_t cb = c.getCornerBlock();
+	block_info_t eb = c.getEdgeBlock();
+
+	int8_t cp[8], co[8], ep[12], eo[12];
+	for(int p = 0; p != 8; ++p)
+	{
+		int q = cb.first[p];
+		cp[corner_pos[s][p]] = corner_piece[s][q];
+		co[corner_pos[s][p]] = corner_orient[s][p][q][cb.second[p]];
+	}
+
+	for(int p = 0; p != 12; ++p)
+	{
+		int q = eb.first[p];
+		ep[edge_pos[s][p]] = edge_piece[s][q];
+		eo[edge_pos[s][p]] = edge_orient[s][p][q][eb.second[p]];
+	}
+
+	return cube_t(cp, co, ep, eo);
+}
+
+} // namespace rubik_cube
@@ -0,0 +1,203 @@
+/**
+    Symmetries of Rubik's Cube and symmetry reduced coordinates.
+ **/
+#ifndef __SYMMETRY_HPP__
+#define __SYMMETRY_HPP__
+
+#include "cube.h"
+#include "heuristic.hpp"
+#include "table_memory.hpp"
+#include <vector>
+#include <cstdint>
+
+namespace rubik_cube
+{
+
+/*
+ * the 48 symmetries of the cube (rotations and reflections), a symmetry
+ * acts on a cube by moving the whole cube and recoloring it in the same
+ * way, so that the distance to the solved cube is not changed.
+ *
+ * the symmetry 0 is the identity and the symmetry 0-15 keep the UD axis.
+ *
+ * the block q at position p with orientation o is moved to the position
+ * corner_pos[s][p] (edge_pos[s][p]), it becomes corner_piece[s][q] and
+ * its orientation becomes corner_orient[s][p][q][o].
+ */
+struct symmetry_t
+{
+	static const int count = 48;
+	static const int ud_count = 16;
+
+	static int8_t inverse[count];
+	/* conjugating by multiply[t][s] is conjugating by s and then by t */
+	static int8_t multiply[count][count];
+	static int8_t corner_pos[count][8];
+	static int8_t corner_piece[count][8];
+	static int8_t corner_orient[count][8][8][3];
+	static int8_t edge_pos[count][12];
+	static int8_t edge_piece[count][12];
+	static int8_t edge_orient[count][12][12][2];
+
+	/* the symmetry of the geometric transformation, returns -1 if
+	 * the matrix is not a symmetry of the cube, the axes are
+	 * 0 = left to right, 1 = back to front, 2 = bottom to top */
+	static int find(const int (&matrix)[3][3]);
+
+	static cube_t conjugate(const cube_t&, int s);
+};
+
+/*
+ * permutations of a group of K blocks (corners when N = 8 or edges when
+ * N = 12) reduced by the symmetries keeping the group. the permutation is
+ * encoded by encode_perm of the positions of the blocks in the group.
+ */
+template<int N, int K>
+class sym_perm_t
+{
+public:
+	static const int S = K < N ? K : N - 1;
+	static const int perm_size = factorial<N, S>::value;
+public:
+	/* group[k] is the k-th block of the group, syms should keep the group.
+	 * the lookup table is built unless it is given, e.g. mapped from a
+	 * table file, then only the classes are rebuilt from it */
+	void init(const int8_t *group, const std::vector<int>& syms,
+		const uint32_t *lookup_table = nullptr);
+
+	/* class << 8 | stab << 7 | s, where conjugating by s gives the 
+	 * representative and stab is set if its stabilizer is not trivial */
+	uint32_t lookup(int code) const
+	{
+		const uint8_t *local = replicas.local(reinterpret_cast<const uint8_t*>(table));
+		return reinterpret_cast<const uint32_t*>(local)[code];
+	}
+
+	/* copy the lookup table to each NUMA node */
+	void replicate()
+	{
+		replicas.assign(reinterpret_cast<const uint8_t*>(table), perm_size * sizeof(uint32_t));
+	}
+
+	/* the lookup table of perm_size entries */
+	const uint32_t* data() const { return table; }
+
+	/* the symmetries except the identity keeping the representative,
+	 * the cubes in the class should be reduced by all of them */
+	const std::vector<int8_t>& stabilizer(int cls) const { return stabs[cls]; }
+
+	int class_num() const { return (int)reps.size(); }
+	int representative(int cls) const { return reps[cls]; }
+	int group_index(int block) const { return index[block]; }
+
+	/* pos[k] is the position of the k-th block of the group, the
+	 * permutation after conjugating by s is stored to out */
+	void conjugate(const int8_t *pos, int s, int8_t *out) const;
+private:
+	int8_t group[K], index[N];
+	table_memory_t memory; // the entries of table if it is built
+	const uint32_t *table = nullptr;
+	table_replicas_t replicas;
+	std::vector<int> reps;
+	std::vector<std::vector<int8_t>> stabs;
+};
+
+template<int N, int K>
+void sym_perm_t<N, K>::conjugate(const int8_t *pos, int s, int8_t *out) const
+{
+	const int8_t *P = N == 8 ? symmetry_t::corner_pos[s] : symmetry_t::edge_pos[s];
+	const int8_t *Q = N == 8 ? symmetry_t::corner_piece[s] : symmetry_t::edge_piece[s];
+	for(int k = 0; k != K; ++k)
+		out[index[Q[group[k]]]] = P[pos[k]];
+}
+
+template<int N, int K>
+void sym_perm_t<N, K>::init(const int8_t *group, const std::vector<int>& syms,
+	const uint32_t *lookup_table)
+{
+	static const int *k = N == 8 ? factorial_8 : factorial_12;
+
+	for(int i = 0; i != N; ++i)
+		index[i] = -1;
+	for(int i = 0; i != K; ++i)
+	{
+		this->group[i] = group[i];
+		index[group[i]] = i;
+	}
+
+	reps.clear();
+	stabs.clear();
+	replicas.clear();
+
+	int8_t pos[N], conj[N];
+	std::vector<int8_t> stab;
+
+	// a representative is conjugated to itself by the identity, and
+	// only the ones with a nontrivial stabilizer are conjugated again
+	if(lookup_table)
+	{
+		memory.clear();
+		table = lookup_table;
+		for(int v = 0; v != perm_size; ++v)
+		{
+			if(table[v] & 0x3f)
+				continue;
+
+			stab.clear();
+			if(table[v] & 0x80)
+			{
+				decode_perm<N, S>(v, pos, k);
+				for(int s : syms)
+				{
+					conjugate(pos, s, conj);
+					if(s && encode_perm<N, S>(conj, k) == v)
+						stab.push_back(s);
+				}
+			}
+
+			reps.push_back(v);
+			stabs.push_back(stab);
+		}
+
+		return;
+	}
+
+	memory.assign(perm_size * sizeof(uint32_t), 0);
+	uint32_t *entries = reinterpret_cast<uint32_t*>(memory.data());
+	table = entries;
+
+	// the classes are numbered by the order of their representatives,
+	// which are less than the other permutations of their classes
+	for(int v = 0; v != perm_size; ++v)
+	{
+		decode_perm<N, S>(v, pos, k);
+
+		int rep = v, rep_sym = 0;
+		stab.clear();
+		for(int s : syms)
+		{
+			conjugate(pos, s, conj);
+			int code = encode_perm<N, S>(conj, k);
+			if(code < rep)
+			{
+				rep = code;
+				rep_sym = s;
+			} else if(code == v && s) {
+				stab.push_back(s);
+			}
+		}
+
+		if(rep == v)
+		{
+			entries[v] = uint32_t(reps.size()) << 8 | (stab.empty() ? 0 : 0x80);
+			reps.push_back(v);
+			stabs.push_back(stab);
+		} else {
+			entries[v] = entries[rep] | rep_sym;
+		}
+	}
+}
+
+} // namespace rubik_cube
+
+#endif // __SYMMETRY_HPP__
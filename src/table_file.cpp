@@ -0,0 +1,197 @@
+#include "table_file.hpp"
+#include "table_memory.hpp"
+#include <cstdio>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace rubik_cube
+{
+
+namespace
+{
+	const char file_magic[8] = { 'R', 'U', 'B', 'I', 'K', 'P', 'D', 'B' };
+	const size_t page_size = 4096;
+
+	struct file_header_t
+	{
+		char magic[8];
+		uint32_t format_version;
+		uint32_t version;
+		char algo[16];
+		uint32_t table_num;
+		uint32_t reserved;
+	};
+
+	struct table_entry_t
+	{
+		char name[16];
+		uint32_t bits;
+		uint32_t size;
+		uint64_t offset;
+		uint64_t bytes;
+		uint64_t checksum;
+	};
+
+	size_t align_page(size_t n)
+	{
+		return (n + page_size - 1) / page_size * page_size;
+	}
+
+	bool write_all(int fd, const void *data, size_t bytes, size_t offset)
+	{
+		const char *p = static_cast<const char*>(data);
+		while(bytes != 0)
+		{
+			ssize_t n = pwrite(fd, p, bytes, offset);
+			if(n < 0 && errno == EINTR)
+				continue;
+			if(n <= 0)
+				return false;
+
+			p += n;
+			bytes -= n;
+			offset += n;
+		}
+
+		return true;
+	}
+}
+
+uint64_t table_file_t::checksum(const uint8_t *data, size_t bytes)
+{
+	// FNV-1a over 8-byte words
+	uint64_t h = 14695981039346656037ull, w;
+	size_t i = 0;
+	for(; i + 8 <= bytes; i += 8)
+	{
+		std::memcpy(&w, data + i, 8);
+		h = (h ^ w) * 1099511628211ull;
+	}
+
+	for(; i != bytes; ++i)
+		h = (h ^ data[i]) * 1099511628211ull;
+
+	return h;
+}
+
+bool table_file_t::open(const char *filename, const char *algo, uint32_t version, bool verify)
+{
+	close();
+
+	int fd = ::open(filename, O_RDONLY);
+	if(fd < 0) return false;
+
+	struct stat st;
+	if(fstat(fd, &st) == 0 && size_t(st.st_size) >= sizeof(file_header_t))
+	{
+		length = st.st_size;
+		addr = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+		if(addr == MAP_FAILED)
+			addr = nullptr;
+		else table_memory_t::advise_huge_pages(addr, length);
+	}
+
+	::close(fd);
+	if(!addr) return false;
+
+	const uint8_t *base = static_cast<const uint8_t*>(addr);
+	file_header_t header;
+	std::memcpy(&header, base, sizeof(header));
+
+	bool ok = std::memcmp(header.magic, file_magic, sizeof(file_magic)) == 0
+		&& header.format_version == format_version
+		&& header.version == version
+		&& std::strncmp(header.algo, algo, sizeof(header.algo)) == 0
+		&& sizeof(header) + header.table_num * sizeof(table_entry_t) <= length;
+
+	for(uint32_t i = 0; ok && i != header.table_num; ++i)
+	{
+		table_entry_t e;
+		std::memcpy(&e, base + sizeof(header) + i * sizeof(e), sizeof(e));
+
+		// the checksum reads the whole table, so it is only computed
+		// if asked, the other checks only read the directory
+		ok = e.offset <= length && e.bytes <= length - e.offset
+			&& e.bytes >= (uint64_t(e.size) * e.bits + 7) / 8
+			&& (!verify || checksum(base + e.offset, e.bytes) == e.checksum);
+
+		table_info_t info;
+		info.name.assign(e.name, strnlen(e.name, sizeof(e.name)));
+		info.bits = e.bits;
+		info.size = e.size;
+		info.data = base + e.offset;
+		info.bytes = e.bytes;
+		tables.push_back(info);
+	}
+
+	if(!ok) close();
+	return ok;
+}
+
+void table_file_t::close()
+{
+	if(addr) munmap(addr, length);
+	addr = nullptr;
+	length = 0;
+	tables.clear();
+}
+
+const uint8_t* table_file_t::find(const char *name, int bits, int size) const
+{
+	for(const table_info_t& t : tables)
+		if(t.name == name && t.bits == bits && t.size == size)
+			return t.data;
+	return nullptr;
+}
+
+bool table_file_t::save(const char *filename, const char *algo, uint32_t version,
+	const std::vector<table_info_t>& tables)
+{
+	file_header_t header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, file_magic, sizeof(file_magic));
+	header.format_version = format_version;
+	header.version = version;
+	std::strncpy(header.algo, algo, sizeof(header.algo) - 1);
+	header.table_num = tables.size();
+
+	std::vector<table_entry_t> entries(tables.size());
+	size_t offset = align_page(sizeof(header) + entries.size() * sizeof(table_entry_t));
+	for(size_t i = 0; i != tables.size(); ++i)
+	{
+		table_entry_t& e = entries[i];
+		std::memset(&e, 0, sizeof(e));
+		std::strncpy(e.name, tables[i].name.c_str(), sizeof(e.name) - 1);
+		e.bits = tables[i].bits;
+		e.size = tables[i].size;
+		e.offset = offset;
+		e.bytes = tables[i].bytes;
+		e.checksum = checksum(tables[i].data, tables[i].bytes);
+		offset = align_page(offset + e.bytes);
+	}
+
+	// written to a temporary file of a unique name and renamed, so
+	// that the processes loading the file never see a partial one and
+	// the processes saving it at the same time never mix their data
+	std::string tmp = std::string(filename) + ".XXXXXX";
+	int fd = mkstemp(&tmp[0]);
+	if(fd < 0) return false;
+
+	bool ok = fchmod(fd, 0644) == 0
+		&& write_all(fd, &header, sizeof(header), 0)
+		&& write_all(fd, entries.data(), entries.size() * sizeof(table_entry_t), sizeof(header));
+	for(size_t i = 0; ok && i != tables.size(); ++i)
+		ok = write_all(fd, tables[i].data, tables[i].bytes, entries[i].offset);
+
+	ok = ::close(fd) == 0 && ok;
+	ok = ok && std::rename(tmp.c_str(), filename) == 0;
+	if(!ok) unlink(tmp.c_str());
+	return ok;
+}
+
+} // namespace rubik_cube
@@ -0,0 +1,66 @@
+/**
+    Versioned file of pruning tables, loaded by mmap.
+ **/
+#ifndef __TABLE_FILE_HPP__
+#define __TABLE_FILE_HPP__
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+namespace rubik_cube
+{
+
+/*
+ * the file starts with a header and the directory of the tables, the
+ * data of each table is aligned to a page. the header records the
+ * algorithm and the version of its coordinates, each table records
+ * its name, bits per entry, number of entries and checksum.
+ *
+ * the file is mapped read-only, so the processes loading the same
+ * file share the pages.
+ */
+class table_file_t
+{
+public:
+	struct table_info_t
+	{
+		std::string name;
+		int bits, size;
+		const uint8_t *data;
+		size_t bytes;
+	};
+
+	static const uint32_t format_version = 1;
+public:
+	table_file_t() = default;
+	table_file_t(const table_file_t&) = delete;
+	table_file_t& operator = (const table_file_t&) = delete;
+	~table_file_t() { close(); }
+public:
+	/* returns false if the file is missing, truncated or generated by
+	 * another algorithm or version. the checksums are only checked if
+	 * verify is set, which reads the whole file */
+	bool open(const char *filename, const char *algo, uint32_t version, bool verify = false);
+	void close();
+
+	/* the data of the table, nullptr if the table is not found or
+	 * its bits or size does not match */
+	const uint8_t* find(const char *name, int bits, int size) const;
+
+	/* returns false if the file is not written, the file
+	 * already saved is not changed then */
+	static bool save(const char *filename, const char *algo, uint32_t version,
+		const std::vector<table_info_t>& tables);
+
+	static uint64_t checksum(const uint8_t *data, size_t bytes);
+private:
+	void *addr = nullptr;
+	size_t length = 0;
+	std::vector<table_info_t> tables;
+};
+
+} // namespace rubik_cube
+
+#endif // __TABLE_FILE_HPP__
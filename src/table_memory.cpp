@@ -0,0 +1,187 @@
+#include "table_memory.hpp"
+#include <new>
+#include <algorithm>
+#include <vector>
+#include <thread>
+#include <cstdio>
+#include <cstring>
+#include <sched.h>
+#include <sys/mman.h>
+
+namespace rubik_cube
+{
+
+namespace
+{
+	const size_t page_size = 4096;
+	const size_t huge_page_size = 2 << 20;
+
+	size_t align(size_t n, size_t page)
+	{
+		return (n + page - 1) / page * page;
+	}
+
+	/* the memory aligned to a huge page, so that all of it can be
+	 * backed by transparent huge pages */
+	void* map_aligned(size_t length)
+	{
+		size_t n = length + huge_page_size;
+		void *p = mmap(nullptr, n, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if(p == MAP_FAILED)
+			return p;
+
+		uintptr_t begin = reinterpret_cast<uintptr_t>(p);
+		uintptr_t aligned = align(begin, huge_page_size);
+		if(aligned != begin)
+			munmap(p, aligned - begin);
+		munmap(reinterpret_cast<void*>(aligned + length), begin + n - aligned - length);
+		return reinterpret_cast<void*>(aligned);
+	}
+
+	/* the CPUs of the nodes, a list like 0-3,8-11 for each node */
+	std::vector<cpu_set_t> read_nodes()
+	{
+		std::vector<cpu_set_t> nodes;
+		for(int id = 0; nodes.size() != size_t(numa_t::max_nodes) && id != 64; ++id)
+		{
+			char name[64];
+			std::snprintf(name, sizeof(name), "/sys/devices/system/node/node%d/cpulist", id);
+			FILE *fp = std::fopen(name, "r");
+			if(!fp) continue;
+
+			cpu_set_t cpus;
+			CPU_ZERO(&cpus);
+			for(int a, b; std::fscanf(fp, "%d", &a) == 1; )
+			{
+				b = a;
+				if(std::fscanf(fp, "-%d", &b) != 1)
+					b = a;
+				for(int c = a; c <= b && c < CPU_SETSIZE; ++c)
+					CPU_SET(c, &cpus);
+				if(std::fgetc(fp) != ',')
+					break;
+			}
+
+			std::fclose(fp);
+			if(CPU_COUNT(&cpus) != 0)
+				nodes.push_back(cpus);
+		}
+
+		return nodes;
+	}
+
+	const std::vector<cpu_set_t>& nodes()
+	{
+		static const std::vector<cpu_set_t> nodes = read_nodes();
+		return nodes;
+	}
+}
+
+__thread int numa_t::current = 0;
+
+int numa_t::node_count()
+{
+	return std::max<int>(1, nodes().size());
+}
+
+bool numa_t::bind(int node)
+{
+	if(node < 0 || node >= int(nodes().size()))
+		return false;
+	if(sched_setaffinity(0, sizeof(cpu_set_t), &nodes()[node]) != 0)
+		return false;
+
+	current = node;
+	return true;
+}
+
+void table_replicas_t::assign(const uint8_t *data, size_t bytes)
+{
+	clear();
+
+	// the threads filling the copies are bound to the nodes, and the
+	// pages are allocated on the node of the thread touching them first
+	std::vector<std::thread> threads;
+	for(int k = 1; k < numa_t::node_count(); ++k)
+	{
+		threads.emplace_back([this, k, data, bytes] {
+			if(numa_t::bind(k))
+			{
+				memory[k].assign(bytes, 0);
+				std::memcpy(memory[k].data(), data, bytes);
+			}
+		} );
+	}
+
+	for(auto& t : threads)
+		t.join();
+
+	for(int k = 1; k < numa_t::node_count(); ++k)
+		if(memory[k].size() != 0)
+			nodes[k] = memory[k].data();
+}
+
+void table_replicas_t::clear()
+{
+	for(int k = 0; k != numa_t::max_nodes; ++k)
+	{
+		memory[k].clear();
+		nodes[k] = nullptr;
+	}
+}
+
+void table_memory_t::assign(size_t bytes, uint8_t value)
+{
+	clear();
+	if(bytes == 0) return;
+
+	void *p = MAP_FAILED;
+	if(bytes < huge_page_size)
+	{
+		// the small tables are not worth a huge page
+		length = align(bytes, page_size);
+		p = mmap(nullptr, length, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	} else {
+		length = align(bytes, huge_page_size);
+#ifdef MAP_HUGETLB
+		// fails if the huge pages are not reserved
+		p = mmap(nullptr, length, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+		if(p == MAP_FAILED)
+		{
+			p = map_aligned(length);
+			if(p != MAP_FAILED)
+				advise_huge_pages(p, length);
+		}
+	}
+
+	if(p == MAP_FAILED)
+	{
+		length = 0;
+		throw std::bad_alloc();
+	}
+
+	addr = p;
+	count = bytes;
+	std::memset(addr, value, bytes);
+}
+
+void table_memory_t::clear()
+{
+	if(addr) munmap(addr, length);
+	addr = nullptr;
+	length = count = 0;
+}
+
+void table_memory_t::advise_huge_pages(const void *addr, size_t bytes)
+{
+#ifdef MADV_HUGEPAGE
+	// only a hint, the small pages are used if it fails
+	madvise(const_cast<void*>(addr), bytes, MADV_HUGEPAGE);
+#endif
+}
+
+} // namespace rubik_cube
@@ -0,0 +1,104 @@
+/**
+    Memory of the large pruning tables, backed by huge pages and
+    replicated to the NUMA nodes.
+ **/
+#ifndef __TABLE_MEMORY_HPP__
+#define __TABLE_MEMORY_HPP__
+
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+
+namespace rubik_cube
+{
+
+/*
+ * the tables are looked up randomly, so most of the lookups miss the
+ * TLB when the tables are mapped by 4 KB pages. the memory is mapped
+ * by explicit huge pages if they are reserved (vm.nr_hugepages), or
+ * else by transparent huge pages.
+ */
+class table_memory_t
+{
+public:
+	table_memory_t() = default;
+	table_memory_t(const table_memory_t&) = delete;
+	table_memory_t& operator = (const table_memory_t&) = delete;
+	~table_memory_t() { clear(); }
+public:
+	/* bytes of memory filled by value */
+	void assign(size_t bytes, uint8_t value);
+	void clear();
+
+	void swap(table_memory_t& r)
+	{
+		std::swap(addr, r.addr);
+		std::swap(length, r.length);
+		std::swap(count, r.count);
+	}
+
+	uint8_t* data() { return static_cast<uint8_t*>(addr); }
+	const uint8_t* data() const { return static_cast<const uint8_t*>(addr); }
+	size_t size() const { return count; }
+
+	/* ask the kernel to back the mapped memory by huge pages,
+	 * e.g. a file on a filesystem supporting them */
+	static void advise_huge_pages(const void *addr, size_t bytes);
+private:
+	void *addr = nullptr;
+	size_t length = 0, count = 0;
+};
+
+/*
+ * the NUMA nodes with CPUs, read from sysfs without libnuma. the
+ * workers of the thread pool are bound to the nodes in turn, so that
+ * they look up the replicas of the tables on their own nodes.
+ */
+struct numa_t
+{
+	static const int max_nodes = 8;
+
+	/* 1 if the machine is not NUMA or the nodes are unknown */
+	static int node_count();
+
+	/* bind this thread to the CPUs of the node (0 to node_count() - 1),
+	 * returns false if it is not bound */
+	static bool bind(int node);
+
+	/* the node this thread is bound to, 0 if it is not bound */
+	static int node() { return current; }
+private:
+	// __thread instead of thread_local, which costs a call to the
+	// wrapper of the variable on each lookup
+	static __thread int current;
+};
+
+/*
+ * a copy of a table on each node except the first one, which is filled
+ * by a thread bound to the node so that its pages are allocated there
+ * on the first touch. there is no copy if there is only one node.
+ */
+class table_replicas_t
+{
+public:
+	table_replicas_t() = default;
+	table_replicas_t(const table_replicas_t&) = delete;
+	table_replicas_t& operator = (const table_replicas_t&) = delete;
+public:
+	void assign(const uint8_t *data, size_t bytes);
+	void clear();
+
+	/* the copy of data on the node of this thread */
+	const uint8_t* local(const uint8_t *data) const
+	{
+		const uint8_t *p = nodes[numa_t::node()];
+		return p ? p : data;
+	}
+private:
+	table_memory_t memory[numa_t::max_nodes];
+	const uint8_t *nodes[numa_t::max_nodes] = {};
+};
+
+} // namespace rubik_cube
+
+#endif // __TABLE_MEMORY_HPP__
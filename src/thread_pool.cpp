@@ -0,0 +1,153 @@
+#include "thread_pool.hpp"
+#include "table_memory.hpp"
+
+namespace rubik_cube
+{
+
+namespace
+{
+	// the id of the worker running on this thread, -1 for the others
+	thread_local int worker_id = -1;
+}
+
+thread_pool_t::thread_pool_t()
+	: queues(new queue_t[max_workers + 1]), worker_num(0), queued(0), idle(0), quit(false)
+{
+}
+
+thread_pool_t::~thread_pool_t()
+{
+	{
+		std::lock_guard<std::mutex> lk(m);
+		quit = true;
+	}
+
+	cv.notify_all();
+	for(auto& w : workers)
+		w.join();
+}
+
+thread_pool_t& thread_pool_t::shared()
+{
+	static thread_pool_t pool;
+	return pool;
+}
+
+void thread_pool_t::reserve(int n)
+{
+	std::lock_guard<std::mutex> lk(m);
+	for(int id = worker_num; id < n && id < max_workers; ++id)
+	{
+		workers.emplace_back(&thread_pool_t::work, this, id);
+		++worker_num;
+	}
+}
+
+void thread_pool_t::submit(task_t task)
+{
+	push(queues[worker_id >= 0 ? worker_id : max_workers], std::move(task));
+}
+
+void thread_pool_t::submit_shared(task_t task)
+{
+	push(queues[max_workers], std::move(task));
+}
+
+void thread_pool_t::push(queue_t& q, task_t task)
+{
+	{
+		std::lock_guard<std::mutex> lk(q.m);
+		q.tasks.push_back(std::move(task));
+	}
+
+	++queued;
+
+	// taking the lock makes sure that a worker checking queued
+	// before waiting is either woken up or sees the task
+	{
+		std::lock_guard<std::mutex> lk(m);
+	}
+
+	cv.notify_one();
+}
+
+bool thread_pool_t::run_local()
+{
+	if(worker_id < 0)
+		return false;
+
+	task_t task;
+	{
+		queue_t& q = queues[worker_id];
+		std::lock_guard<std::mutex> lk(q.m);
+		if(q.tasks.empty())
+			return false;
+
+		task = std::move(q.tasks.back());
+		q.tasks.pop_back();
+		--queued;
+	}
+
+	task();
+	return true;
+}
+
+bool thread_pool_t::pop(int id, task_t& task)
+{
+	{
+		queue_t& q = queues[id];
+		std::lock_guard<std::mutex> lk(q.m);
+		if(!q.tasks.empty())
+		{
+			task = std::move(q.tasks.back());
+			q.tasks.pop_back();
+			--queued;
+			return true;
+		}
+	}
+
+	// the shared queue, then the other workers
+	int n = worker_num;
+	for(int i = -1; i != n; ++i)
+	{
+		queue_t& q = queues[i < 0 ? max_workers : (id + i + 1) % n];
+		std::lock_guard<std::mutex> lk(q.m);
+		if(!q.tasks.empty())
+		{
+			task = std::move(q.tasks.front());
+			q.tasks.pop_front();
+			--queued;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void thread_pool_t::work(int id)
+{
+	worker_id = id;
+
+	// the workers are spread over the NUMA nodes in turn, and look up
+	// the replicas of the tables on their own nodes
+	if(numa_t::node_count() > 1)
+		numa_t::bind(id % numa_t::node_count());
+
+	for(task_t task; ; )
+	{
+		if(pop(id, task))
+		{
+			task();
+			task = nullptr;
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lk(m);
+		++idle;
+		cv.wait(lk, [this] { return queued > 0 || quit; });
+		--idle;
+		if(quit) return;
+	}
+}
+
+} // namespace rubik_cube
@@ -0,0 +1,86 @@
+/**
+    Work-stealing thread pool shared by the searches.
+ **/
+#ifndef __THREAD_POOL_HPP__
+#define __THREAD_POOL_HPP__
+
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <condition_variable>
+
+namespace rubik_cube
+{
+
+/*
+ * each worker has its own queue, the tasks submitted by a worker are
+ * pushed to its queue and popped from the back (the latest, which is
+ * the smallest subtree), an idle worker steals from the front of the
+ * other queues (the oldest, which is the largest subtree). the tasks
+ * submitted by the other threads are pushed to a shared queue.
+ *
+ * the workers are created on demand and live until the program exits.
+ */
+class thread_pool_t
+{
+public:
+	typedef std::function<void()> task_t;
+	static const int max_workers = 256;
+public:
+	thread_pool_t();
+	~thread_pool_t();
+	thread_pool_t(const thread_pool_t&) = delete;
+	thread_pool_t& operator = (const thread_pool_t&) = delete;
+public:
+	/* the pool used by all the algorithms */
+	static thread_pool_t& shared();
+
+	/* there are at least n workers */
+	void reserve(int n);
+	int size() const { return worker_num; }
+
+	/* a task submitted by a worker is pushed to its queue, which it
+	 * may run while waiting, e.g. a split subtree */
+	void submit(task_t task);
+
+	/* pushed to the shared queue even if submitted by a worker, for
+	 * the tasks not waited by it, e.g. the solving of another cube */
+	void submit_shared(task_t task);
+
+	/* run a task of the queue of this worker, returns false if it is
+	 * empty or this thread is not a worker. a worker waiting for the
+	 * tasks submitted by itself runs them, so that the workers waiting
+	 * for each other never block the whole pool */
+	bool run_local();
+
+	/* true if some worker is waiting for a task, so that
+	 * a task submitted now is run at once */
+	bool starving() const { return queued < idle; }
+private:
+	struct queue_t
+	{
+		std::mutex m;
+		std::deque<task_t> tasks;
+	};
+
+	void push(queue_t& q, task_t task);
+	bool pop(int id, task_t& task);
+	void work(int id);
+private:
+	// queues[max_workers] is the shared queue
+	std::unique_ptr<queue_t[]> queues;
+	std::vector<std::thread> workers;
+	std::atomic<int> worker_num, queued, idle;
+	bool quit;
+
+	std::mutex m;
+	std::condition_variable cv;
+};
+
+} // namespace rubik_cube
+
+#endif // __THREAD_POOL_HPP__
@@ -0,0 +1,102 @@
+#include "transposition.hpp"
+
+namespace rubik_cube
+{
+
+namespace
+{
+	const int g_bits = 6;
+	const uint64_t g_mask = (1u << g_bits) - 1;
+	const uint64_t stamp_mask = (1u << transposition_table_t::stamp_bits) - 1;
+	const uint64_t key_mask = ~0ull << (transposition_table_t::stamp_bits + g_bits);
+
+	inline uint64_t load(const uint64_t *p)
+	{
+		return __atomic_load_n(p, __ATOMIC_RELAXED);
+	}
+
+	// a lost race only loses an entry, so the result is ignored
+	inline void store(uint64_t *p, uint64_t expected, uint64_t desired)
+	{
+		__atomic_compare_exchange_n(p, &expected, desired, false,
+			__ATOMIC_RELAXED, __ATOMIC_RELAXED);
+	}
+}
+
+void transposition_table_t::init(size_t bytes)
+{
+	uint64_t buckets = 1;
+	while(buckets * 2 * bucket_size * sizeof(uint64_t) <= bytes)
+		buckets <<= 1;
+
+	memory.assign(buckets * bucket_size * sizeof(uint64_t), 0);
+	slots = reinterpret_cast<uint64_t*>(memory.data());
+	mask = buckets - 1;
+}
+
+uint32_t transposition_table_t::next_stamp() const
+{
+	// the first stamp of a round starts it, so the stamps in the
+	// entries are never 0, the stamp of the empty entries
+	std::lock_guard<std::mutex> lk(stamp_mutex);
+	const uint32_t round_mask = (1u << round_bits) - 1;
+	if((++last_stamp & round_mask) == 0)
+	{
+		round = last_stamp >> round_bits;
+		clear();
+		++last_stamp;
+	}
+
+	return last_stamp;
+}
+
+void transposition_table_t::clear() const
+{
+	for(uint64_t i = 0; i != (mask + 1) * bucket_size; ++i)
+		__atomic_store_n(slots + i, 0, __ATOMIC_RELAXED);
+}
+
+bool transposition_table_t::visit(uint64_t hash, int g, uint32_t stamp) const
+{
+	// an iteration of an old round is not pruned any more
+	if(stamp >> round_bits != round.load(std::memory_order_relaxed))
+		return true;
+
+	// the bucket is chosen by the low bits, the key is the high bits
+	stamp &= stamp_mask;
+	uint64_t key = hash & key_mask;
+	uint64_t entry = key | uint64_t(stamp) << g_bits | g;
+	uint64_t *bucket = slots + (hash & mask) * bucket_size;
+
+	int victim = 0, victim_score = -1;
+	for(int i = 0; i != bucket_size; ++i)
+	{
+		uint64_t e = load(bucket + i);
+		bool current = (e >> g_bits & stamp_mask) == stamp;
+		if(current && (e & key_mask) == key)
+		{
+			if(int(e & g_mask) <= g)
+			{
+				hit_count.fetch_add(1, std::memory_order_relaxed);
+				return false;
+			}
+
+			store(bucket + i, e, entry);
+			miss_count.fetch_add(1, std::memory_order_relaxed);
+			return true;
+		}
+
+		int score = current ? int(e & g_mask) : 0x100;
+		if(score > victim_score)
+		{
+			victim = i;
+			victim_score = score;
+		}
+	}
+
+	store(bucket + victim, load(bucket + victim), entry);
+	miss_count.fetch_add(1, std::memory_order_relaxed);
+	return true;
+}
+
+} // namespace rubik_cube
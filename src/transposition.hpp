@@ -0,0 +1,81 @@
+/**
+    Transposition table of the cubes explored by an iteration of IDA*.
+ **/
+#ifndef __TRANSPOSITION_HPP__
+#define __TRANSPOSITION_HPP__
+
+#include "table_memory.hpp"
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+namespace rubik_cube
+{
+
+/*
+ * many move sequences reach the same cube, e.g. the commuting moves of
+ * the opposite faces. if an iteration has explored a cube with g moves,
+ * its subtree with more than g moves has no solution either (or the
+ * solution is found by the first one), so it is pruned.
+ *
+ * each entry is (34 bits of the hash, the stamp of the iteration in
+ * 24 bits, g in 6 bits), 0 is empty. the stamps are issued by rounds
+ * of 2^23, the table is cleared before a round starts and the low bit
+ * of the round is kept in the stamps, so a stale entry never prunes a
+ * cube not explored by the iteration:
+ *   - no stamp of the new round is issued until the table is cleared,
+ *   - the iterations of an old round no longer read or write it, and
+ *     an entry written by them while it is cleared has the other
+ *     parity, which is cleared again before it is reused.
+ *
+ * the entries of a cache line form a bucket, a new entry replaces one of an old iteration, or else the
+ * one with the largest g whose subtree is the smallest. the entries
+ * are read and written atomically without locks, so the table is
+ * shared by the threads searching an iteration.
+ */
+class transposition_table_t
+{
+public:
+	/* the table takes at most bytes of memory */
+	void init(size_t bytes);
+	bool empty() const { return slots == nullptr; }
+
+	/* a different stamp for each iteration, which are not mixed
+	 * even if several cubes are solved at the same time */
+	uint32_t next_stamp() const;
+
+	static const int stamp_bits = 24;
+	static const int round_bits = stamp_bits - 1;
+
+	void prefetch(uint64_t hash) const
+	{
+		__builtin_prefetch(slots + (hash & mask) * bucket_size);
+	}
+
+	/* returns false if the cube is explored with at most g moves by
+	 * the iteration of stamp, otherwise records g and returns true */
+	bool visit(uint64_t hash, int g, uint32_t stamp) const;
+
+	uint64_t hits() const { return hit_count.load(); }
+	uint64_t misses() const { return miss_count.load(); }
+private:
+	static const int bucket_size = 8;
+
+	void clear() const;
+
+	uint64_t mask = 0;
+	uint64_t *slots = nullptr;
+	table_memory_t memory;
+
+	// last_stamp is changed under stamp_mutex, round is the current
+	// round read by visit
+	mutable std::mutex stamp_mutex;
+	mutable uint32_t last_stamp = 0;
+	mutable std::atomic<uint32_t> round{0};
+	mutable std::atomic<uint64_t> hit_count{0}, miss_count{0};
+};
+
+} // namespace rubik_cube
+
+#endif // __TRANSPOSITION_HPP__